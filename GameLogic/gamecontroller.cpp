@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 
 #include <QTimerEvent>
@@ -7,39 +8,21 @@
 
 namespace Logic {
 
-class GameController::Command
-{
-public:
-  explicit Command(StepId step, PatternTrs pattern_trs, QPoint cells, PlayerId player)
-    : step_(step)
-    , player_(player)
-    , pattern_trs_(std::move(pattern_trs))
-    , cells_(cells)
-  {}
+namespace {
 
-  void apply(LifeProcessor& processor) const
-  {
-    auto const& pattern = pattern_trs_.first;
-    auto const& trs = pattern_trs_.second;
-    Q_ASSERT(pattern != nullptr);
-    for (auto const& unit : pattern->points())
-    {
-      auto const position = loopPos(unit * trs, cells_);
-      processor.addUnit(LifeUnit(static_cast<uint16_t>(position.x()),
-                                 static_cast<uint16_t>(position.y()), player_));
-    }
-  }
+constexpr auto const c_lookahead_interval = 1;
+constexpr auto const c_max_steps_per_tick = 8;
+constexpr auto const c_idle_update_time = 250;
 
-private:
-  StepId const step_ = 0;
-  PlayerId const player_ = 0;
-  PatternTrs const pattern_trs_;
-  QPoint const cells_;
-};
+} // namespace
 
 GameController::GameController(QObject* parent, Params const& params)
   : QObject(parent)
   , step_timer_id_(startTimer(params.update_time_, Qt::TimerType::PreciseTimer))
+  , lookahead_timer_id_(startTimer(c_lookahead_interval, Qt::TimerType::CoarseTimer))
+  , target_update_time_(params.update_time_)
+  , step_policy_(params.step_policy_)
+  , command_delay_(params.command_delay_)
   , player_(params.current_player_)
   , score_addition_(params.initial_scores_)
   , game_model_(params.game_model_)
@@ -49,75 +32,256 @@ GameController::GameController(QObject* parent, Params const& params)
   Q_ASSERT(step_timer_id_ != 0);
   Q_ASSERT(player_ >= 0 && player_ < c_max_player_count);
   Q_ASSERT(game_model_ != nullptr);
+  Q_ASSERT(lookahead_timer_id_ != 0);
+  Q_ASSERT(target_update_time_ > 0);
+  auto& life_processor = game_model_->lifeProcessor();
+  life_processor.setLookahead(params.lookahead_);
+  life_processor.setComputedHandler([this]
+  {
+    QMetaObject::invokeMethod(this, [this] { onGenerationComputed(); }, Qt::QueuedConnection);
+  });
+  lag_.update_time_ = target_update_time_;
+  resetSchedule();
 }
 
+// Events already posted by the handler are dropped with the object.
 GameController::~GameController()
 {
+  game_model_->lifeProcessor().setComputedHandler(nullptr);
   qDebug() << "~GameController() Average computation duration: "
-           << average_computation_duration_ / static_cast<qreal>(step_);
+           << average_computation_duration_ / static_cast<qreal>(step_)
+           << " Max lag: " << lag_.max_behind_steps_ << " steps"
+           << " Skipped frames: " << lag_.skipped_frames_;
 }
 
 bool GameController::addPattern(PatternTrs pattern_trs)
 {
   auto const pattern_scores = pattern_trs.first->scores();
-  auto const result = pattern_scores <= scores_;
-  if (result)
+  if (pattern_scores > scores_)
   {
-    scores_ -= pattern_scores;
-    commands_.emplace_back(step_, std::move(pattern_trs), game_model_->cells(), player_);
-    if (game_model_->lifeProcessor().computed())
-    {
-      applyCommands();
-    }
+    return false;
+  }
+  auto& life_processor = game_model_->lifeProcessor();
+  auto const generation = life_processor.generation() + command_delay_;
+  if (!life_processor.post({ std::move(pattern_trs), player_, generation }))
+  {
+    qDebug() << "Too many pending commands";
+    return false;
   }
-  return result;
+  scores_ -= pattern_scores;
+  setIdle(false);
+  // The command drops the precomputed generations.
+  startLookahead();
+  return true;
 }
 
 bool GameController::onStop()
 {
   stopped_ = !stopped_;
+  resetSchedule();
+  setIdle(false);
+  startLookahead();
   return stopped_;
 }
 
+void GameController::runGenerations(StepId generations)
+{
+  if (generations == 0 || turbo_remaining_steps_ != 0)
+  {
+    return;
+  }
+  turbo_steps_ = generations;
+  turbo_remaining_steps_ = generations;
+  turbo_clock_.start();
+  makeTurboStep();
+}
+
+void GameController::jumpTo(StepId step)
+{
+  if (step > step_)
+  {
+    runGenerations(step - step_);
+  }
+}
+
 void GameController::timerEvent(QTimerEvent* event)
 {
+  if (turbo_remaining_steps_ != 0)
+  {
+    return;
+  }
   if (event->timerId() == step_timer_id_)
   {
     makeStep();
   }
+  else if (event->timerId() == lookahead_timer_id_ && !stopped_)
+  {
+    auto& life_processor = game_model_->lifeProcessor();
+    life_processor.precompute();
+    if (life_processor.lookaheadFull())
+    {
+      killTimer(lookahead_timer_id_);
+      lookahead_timer_id_ = 0;
+    }
+  }
 }
 
 void GameController::makeStep()
 {
   auto& life_processor = game_model_->lifeProcessor();
-  if (!life_processor.computed())
+  if (stopped_)
+  {
+    if (life_processor.processLife(false))
+    {
+      emit stepMade(scores_);
+    }
+    else if (life_processor.computed())
+    {
+      setIdle(true);
+    }
+    return;
+  }
+
+  // Steps are made up from the lookahead while the engine keeps the pace,
+  // so a step the engine is not ready for is just postponed to the next tick.
+  auto const due_step = dueStep();
+  auto const max_steps = step_policy_ == StepPolicy::Degrade ? 1 : c_max_steps_per_tick;
+  auto steps = 0;
+  while (step_ < due_step && steps < max_steps && life_processor.processLife(true))
+  {
+    updateStep();
+    ++steps;
+    if (step_policy_ == StepPolicy::CatchUp)
+    {
+      emit stepMade(scores_);
+    }
+  }
+  if (steps > 0 && step_policy_ != StepPolicy::CatchUp)
+  {
+    lag_.skipped_frames_ += static_cast<uint64_t>(steps - 1);
+    emit stepMade(scores_);
+  }
+  if (steps > 0)
+  {
+    startLookahead();
+  }
+  updateLag(due_step);
+}
+
+StepId GameController::dueStep() const
+{
+  // Rounded, so a timer firing a bit early still makes its step.
+  auto const update_time = lag_.update_time_;
+  return schedule_origin_ + static_cast<StepId>((schedule_clock_.elapsed() + update_time / 2) / update_time);
+}
+
+void GameController::resetSchedule()
+{
+  schedule_origin_ = step_;
+  schedule_clock_.start();
+}
+
+void GameController::updateLag(StepId due_step)
+{
+  lag_.behind_steps_ = due_step > step_ ? due_step - step_ : 0;
+  lag_.max_behind_steps_ = std::max(lag_.max_behind_steps_, lag_.behind_steps_);
+  if (step_policy_ != StepPolicy::Degrade)
+  {
+    return;
+  }
+
+  auto const update_time = std::max(target_update_time_, game_model_->lifeProcessor().computationDuration());
+  if (update_time != lag_.update_time_)
+  {
+    qDebug() << "Update time" << lag_.update_time_ << "->" << update_time;
+    lag_.update_time_ = update_time;
+    resetSchedule();
+    emit updateTimeChanged(update_time);
+  }
+}
+
+// An event may come after the next computation has already been started,
+// the one that started it waits for its own event then.
+void GameController::onGenerationComputed()
+{
+  if (turbo_remaining_steps_ != 0 && game_model_->lifeProcessor().computed())
+  {
+    makeTurboStep();
+  }
+}
+
+// Precomputed generations are passed at once, then every computed generation
+// brings the next one through onGenerationComputed(), so nothing polls the engine.
+void GameController::makeTurboStep()
+{
+  auto& life_processor = game_model_->lifeProcessor();
+  while (turbo_remaining_steps_ > 1)
+  {
+    if (!life_processor.skipLife())
+    {
+      return;
+    }
+    updateStep();
+    --turbo_remaining_steps_;
+  }
+  if (!life_processor.processLife(true))
   {
     return;
   }
-  applyCommands();
-  life_processor.processLife(!stopped_);
   updateStep();
   emit stepMade(scores_);
+
+  turbo_remaining_steps_ = 0;
+  resetSchedule();
+  startLookahead();
+
+  auto const elapsed = std::max<qint64>(turbo_clock_.elapsed(), 1);
+  auto const rate = turbo_steps_ * 1000.0 / elapsed;
+  qDebug() << "Run" << turbo_steps_ << "generations in" << elapsed << "ms," << rate << "generations/s";
+  emit generationsRun(turbo_steps_, rate);
 }
 
-void GameController::applyCommands()
+// A stopped game with nothing to show only has to notice the next command,
+// so the step timer slows down and the lookahead timer is stopped.
+void GameController::setIdle(bool idle)
 {
-  auto& life_processor = game_model_->lifeProcessor();
-  Q_ASSERT(life_processor.computed());
-  for (auto const& command : commands_)
+  if (idle == idle_)
+  {
+    return;
+  }
+  idle_ = idle;
+  killTimer(step_timer_id_);
+  step_timer_id_ = startTimer(idle ? c_idle_update_time : target_update_time_, Qt::TimerType::PreciseTimer);
+  Q_ASSERT(step_timer_id_ != 0);
+  if (idle)
+  {
+    if (lookahead_timer_id_ != 0)
+    {
+      killTimer(lookahead_timer_id_);
+      lookahead_timer_id_ = 0;
+    }
+  }
+  else
   {
-    command.apply(life_processor);
+    startLookahead();
   }
-  commands_.clear();
 }
 
-void GameController::updateStep()
+// The lookahead timer only runs while there is room for one more generation.
+void GameController::startLookahead()
 {
-  if (stopped_)
+  if (idle_ || lookahead_timer_id_ != 0)
   {
     return;
   }
+  lookahead_timer_id_ = startTimer(c_lookahead_interval, Qt::TimerType::CoarseTimer);
+  Q_ASSERT(lookahead_timer_id_ != 0);
+}
 
+// Skipped generations have no live units extracted, so they score
+// with the population of the last published one.
+void GameController::updateStep()
+{
   auto const& life_processor = game_model_->lifeProcessor();
   auto const duration = life_processor.computationDuration();
   Q_ASSERT(duration >= 0);
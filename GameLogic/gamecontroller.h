@@ -1,12 +1,36 @@
 #ifndef GAMECONTROLLER_H
 #define GAMECONTROLLER_H
 
+#include <QElapsedTimer>
 #include <QPointer>
 
 #include "gamemodel.h"
 
 namespace Logic {
 
+constexpr SizeT const c_default_lookahead = 8;
+
+// What happens when the engine falls behind the update time.
+enum class StepPolicy : uint8_t
+{
+  // Missed steps are made later, several per tick, and every one is shown.
+  // Peers keep the same cadence, so it is the multiplayer policy.
+  CatchUp,
+  // Missed steps are made later as well, but only the last one of a tick is shown.
+  SkipFrames,
+  // The update time grows to the measured computation duration, steps are never made up.
+  Degrade
+};
+
+struct StepLag
+{
+  // Steps the schedule is ahead of the game.
+  StepId behind_steps_ = 0;
+  StepId max_behind_steps_ = 0;
+  uint64_t skipped_frames_ = 0;
+  int update_time_ = 0;
+};
+
 class GameController final : public QObject
 {
   Q_OBJECT
@@ -18,39 +42,67 @@ public:
     int update_time_ = 0;
     Score initial_scores_ = 0;
     PlayerId current_player_ = 0;
+    SizeT lookahead_ = c_default_lookahead;
+    StepPolicy step_policy_ = StepPolicy::CatchUp;
+    // Generations a placement waits before it lands, time for peers to receive it.
+    StepId command_delay_ = 0;
   };
 
   explicit GameController(QObject* parent, Params const& params);
   ~GameController() override;
 
+  StepLag const& lag() const
+  {
+    return lag_;
+  }
+
 public slots:
   bool addPattern(PatternTrs pattern_trs);
   bool onStop();
+  // Makes the steps as fast as the engine allows, only the last one is shown.
+  void runGenerations(StepId generations);
+  void jumpTo(StepId step);
 
 signals:
   void stepMade(Score scores);
+  void updateTimeChanged(int update_time);
+  void generationsRun(StepId generations, qreal generations_per_second);
 
 protected:
   void timerEvent(QTimerEvent* event) override;
 
 private:
-  class Command;
-  using StepId = uint64_t;
-
   void makeStep();
-  void applyCommands();
+  void onGenerationComputed();
+  void makeTurboStep();
   void updateStep();
+  StepId dueStep() const;
+  void resetSchedule();
+  void updateLag(StepId due_step);
+  void setIdle(bool idle);
+  void startLookahead();
 
-  int const step_timer_id_ = 0;
+  int step_timer_id_ = 0;
+  int lookahead_timer_id_ = 0;
+  int const target_update_time_ = 0;
+  StepPolicy const step_policy_ = StepPolicy::CatchUp;
+  StepId const command_delay_ = 0;
   PlayerId const player_ = 0;
   Score const score_addition_ = 0;
 
   GameModelMutablePtr game_model_;
-  std::vector<Command> commands_;
   StepId step_ = 0;
   Score scores_ = 0;
+  QElapsedTimer schedule_clock_;
+  StepId schedule_origin_ = 0;
+  StepLag lag_;
+  StepId turbo_steps_ = 0;
+  // Non zero while generations are run.
+  StepId turbo_remaining_steps_ = 0;
+  QElapsedTimer turbo_clock_;
   uint64_t average_computation_duration_ = 0;
   bool stopped_ = false;
+  bool idle_ = false;
 };
 using GameControllerPtr = QPointer<GameController>;
 
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_map>
+
 #include <QHash>
 #include <QDebug>
 
@@ -38,6 +42,7 @@ public:
       }
       return true;
     })());
+    all_patterns_.preload();
   }
   ~GameModelImpl() override
   {
@@ -56,6 +61,10 @@ public:
   {
     return all_patterns_.patternAt(idx);
   }
+  Utilities::PatternsPtr patternCatalog() const override
+  {
+    return all_patterns_.catalog();
+  }
   LifeUnits const& lifeUnits() const override
   {
     Q_ASSERT(([&life_units = life_processor_->lifeUnits()]() -> bool
@@ -69,16 +78,24 @@ public:
     })());
     return life_processor_->lifeUnits();
   }
+  LifeSnapshot const& snapshot() const override
+  {
+    return life_processor_->snapshot();
+  }
 
   LifeProcessor& lifeProcessor() override
   {
     Q_ASSERT(life_processor_ != nullptr);
     return *life_processor_;
   }
+  bool exportField(QIODevice& device, FieldFormat format) override
+  {
+    return lifeProcessor().exportField(device, format);
+  }
 
 private:
   QPoint const cells_;
-  PatternsStrategy const all_patterns_;
+  PatternsStrategy all_patterns_;
   LifeProcessorPtr life_processor_;
 };
 
@@ -91,6 +108,158 @@ QPoint loopPos(QPoint point, QPoint cells)
                 (point.y() + cells.y()) % cells.y());
 }
 
+namespace {
+
+struct Symmetry
+{
+  int m11_;
+  int m12_;
+  int m21_;
+  int m22_;
+};
+
+// Linear parts in QMatrix terms: x' = m11 * x + m21 * y, y' = m12 * x + m22 * y.
+Symmetry const c_symmetries[c_pattern_variants] =
+{
+  {  1,  0,  0,  1 }, {  0,  1, -1,  0 }, { -1,  0,  0, -1 }, {  0, -1,  1,  0 },
+  { -1,  0,  0,  1 }, {  0, -1, -1,  0 }, {  1,  0,  0, -1 }, {  0,  1,  1,  0 },
+};
+
+PatternBitmap createPatternBitmap(Points const& points, Symmetry const& symmetry)
+{
+  Points transformed;
+  transformed.reserve(points.size());
+  for (auto const& point : points)
+  {
+    transformed.push_back(QPoint(symmetry.m11_ * point.x() + symmetry.m21_ * point.y(),
+                                 symmetry.m12_ * point.x() + symmetry.m22_ * point.y()));
+  }
+
+  PatternBitmap result;
+  if (transformed.isEmpty())
+  {
+    return result;
+  }
+  auto top_left = transformed.front();
+  auto bottom_right = transformed.front();
+  for (auto const& point : transformed)
+  {
+    top_left = QPoint(std::min(top_left.x(), point.x()), std::min(top_left.y(), point.y()));
+    bottom_right = QPoint(std::max(bottom_right.x(), point.x()), std::max(bottom_right.y(), point.y()));
+  }
+  result.origin_ = top_left;
+  result.size_ = bottom_right - top_left + QPoint(1, 1);
+
+  // Cells sorted by row and column fall into their words in order.
+  std::vector<uint64_t> cells;
+  cells.reserve(static_cast<size_t>(transformed.size()));
+  for (auto const& point : transformed)
+  {
+    auto const row = static_cast<uint64_t>(point.y() - top_left.y());
+    auto const column = static_cast<uint64_t>(point.x() - top_left.x());
+    cells.push_back(row << 32 | column);
+  }
+  std::sort(cells.begin(), cells.end());
+  for (auto const cell : cells)
+  {
+    auto const row = static_cast<uint32_t>(cell >> 32);
+    auto const column = static_cast<uint32_t>(cell);
+    auto const word_column = column - column % c_pattern_bitmap_word_bits;
+    if (result.words_.empty() || result.rows_.back() != row || result.columns_.back() != word_column)
+    {
+      result.rows_.push_back(row);
+      result.columns_.push_back(word_column);
+      result.words_.push_back(0);
+    }
+    result.words_.back() |= uint64_t(1) << (column % c_pattern_bitmap_word_bits);
+  }
+  return result;
+}
+
+} // namespace
+
+// Cells are gathered into the transformed words by their row and word column,
+// the memory stays proportional to the words.
+PatternBitmap transformPatternBitmap(PatternBitmap const& bitmap, PatternVariant variant)
+{
+  Q_ASSERT(variant < c_pattern_variants);
+  auto const& symmetry = c_symmetries[variant];
+  auto const transform = [&symmetry](QPoint point)
+  {
+    return QPoint(symmetry.m11_ * point.x() + symmetry.m21_ * point.y(),
+                  symmetry.m12_ * point.x() + symmetry.m22_ * point.y());
+  };
+
+  PatternBitmap result;
+  if (bitmap.words_.empty())
+  {
+    return result;
+  }
+  auto const first = transform(bitmap.origin_);
+  auto const last = transform(bitmap.origin_ + bitmap.size_ - QPoint(1, 1));
+  auto const top_left = QPoint(std::min(first.x(), last.x()), std::min(first.y(), last.y()));
+  result.origin_ = top_left;
+  result.size_ = QPoint(std::abs(last.x() - first.x()), std::abs(last.y() - first.y())) + QPoint(1, 1);
+
+  std::unordered_map<uint64_t, uint64_t> words;
+  words.reserve(bitmap.words_.size());
+  for (size_t idx = 0; idx < bitmap.words_.size(); ++idx)
+  {
+    auto const row = static_cast<int>(bitmap.rows_[idx]);
+    auto const column = static_cast<int>(bitmap.columns_[idx]);
+    for (auto bits = bitmap.words_[idx]; bits != 0; bits &= bits - 1)
+    {
+      auto const bit = static_cast<int>(qCountTrailingZeroBits(bits));
+      auto const cell = transform(bitmap.origin_ + QPoint(column + bit, row)) - top_left;
+      auto const cell_column = static_cast<uint32_t>(cell.x());
+      auto const key = static_cast<uint64_t>(cell.y()) << 32 | (cell_column - cell_column % c_pattern_bitmap_word_bits);
+      words[key] |= uint64_t(1) << (cell_column % c_pattern_bitmap_word_bits);
+    }
+  }
+
+  std::vector<uint64_t> keys;
+  keys.reserve(words.size());
+  for (auto const& word : words)
+  {
+    keys.push_back(word.first);
+  }
+  std::sort(keys.begin(), keys.end());
+  result.rows_.reserve(keys.size());
+  result.columns_.reserve(keys.size());
+  result.words_.reserve(keys.size());
+  for (auto const key : keys)
+  {
+    result.rows_.push_back(static_cast<uint32_t>(key >> 32));
+    result.columns_.push_back(static_cast<uint32_t>(key));
+    result.words_.push_back(words[key]);
+  }
+  return result;
+}
+
+PatternBitmap const& PatternBitmaps::bitmap(PatternVariant variant) const
+{
+  Q_ASSERT(variant < c_pattern_variants);
+  std::call_once(built_[variant], [this, variant]
+  {
+    bitmaps_[variant] = createPatternBitmap(points_, c_symmetries[variant]);
+  });
+  return bitmaps_[variant];
+}
+
+PatternVariant patternVariant(QMatrix const& trs)
+{
+  for (PatternVariant variant = 0; variant < c_pattern_variants; ++variant)
+  {
+    auto const& symmetry = c_symmetries[variant];
+    if (qFuzzyCompare(trs.m11() + 2.0, symmetry.m11_ + 2.0) && qFuzzyCompare(trs.m12() + 2.0, symmetry.m12_ + 2.0)
+        && qFuzzyCompare(trs.m21() + 2.0, symmetry.m21_ + 2.0) && qFuzzyCompare(trs.m22() + 2.0, symmetry.m22_ + 2.0))
+    {
+      return variant;
+    }
+  }
+  return c_pattern_variants;
+}
+
 uint qHash(LifeUnit unit, uint seed)
 {
   Utilities::Qt::hashCombine(seed, unit.x(), unit.y(), unit.player());
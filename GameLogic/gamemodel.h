@@ -1,25 +1,81 @@
 #ifndef GAMEMODEL_H
 #define GAMEMODEL_H
 
+#include <array>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <QSharedPointer>
 #include <QPoint>
+#include <QRect>
 #include <QVector>
 #include <QMatrix>
 #include <QSet>
 
+class QIODevice;
+
+namespace Utilities {
+
+struct Patterns;
+using PatternsPtr = QSharedPointer<Patterns const>;
+
+} // Utilities
+
 namespace Logic {
 
 using Points = QVector<QPoint>;
 using SizeT = int;
 using PlayerId = uint8_t;
 using Score = uint64_t;
+using StepId = uint64_t;
 
 constexpr uint32_t const c_pow_of_two_max_field_dimension = 15;
 constexpr PlayerId const c_max_player_count = 4;
 
 QPoint loopPos(QPoint point, QPoint cells);
 
+// One of the 8 symmetries of the square: rotations by 90 degrees counter-clockwise
+// are the low two bits, the third bit mirrors x before rotating.
+using PatternVariant = uint8_t;
+constexpr PatternVariant const c_pattern_variants = 8;
+constexpr uint32_t const c_pattern_bitmap_word_bits = 64;
+
+// Pattern points of one variant packed into 64-bit words, only the words holding
+// live cells are kept, ordered by row and column. Bit n of the word idx is the cell
+// (columns_[idx] + n, rows_[idx]) counted from origin_, the top-left cell relative
+// to the pattern center. Huge sparse patterns stay as small as their points.
+struct PatternBitmap
+{
+  QPoint origin_;
+  QPoint size_;
+  std::vector<uint32_t> rows_;
+  std::vector<uint32_t> columns_;
+  std::vector<uint64_t> words_;
+};
+
+// Bitmaps of every variant of the points, built on the first use from any thread.
+// The points are referenced, not copied.
+class PatternBitmaps
+{
+public:
+  explicit PatternBitmaps(Points const& points)
+    : points_(points)
+  {}
+
+  PatternBitmap const& bitmap(PatternVariant variant) const;
+
+private:
+  Points const& points_;
+  mutable std::array<std::once_flag, c_pattern_variants> built_;
+  mutable std::array<PatternBitmap, c_pattern_variants> bitmaps_;
+};
+// The variant built from the words of the identity bitmap, without points, for
+// patterns too big to be expanded.
+PatternBitmap transformPatternBitmap(PatternBitmap const& bitmap, PatternVariant variant);
+// The variant of a transformation made of 90 degrees rotations and mirrors
+// only, otherwise c_pattern_variants.
+PatternVariant patternVariant(QMatrix const& trs);
+
 struct Pattern
 {
   virtual ~Pattern() = default;
@@ -27,6 +83,7 @@ struct Pattern
   virtual Points const& points() const = 0;
   virtual QPoint size() const = 0;
   virtual Score scores() const = 0;
+  virtual PatternBitmap const& bitmap(PatternVariant variant) const = 0;
 };
 using PatternPtr = QSharedPointer<Pattern const>;
 using PatternTrs = QPair<PatternPtr, QMatrix>;
@@ -74,15 +131,87 @@ static_assert(sizeof(LifeUnit) == sizeof(uint32_t), "sizeof(LifeUnit)");
 uint qHash(LifeUnit unit, uint seed);
 using LifeUnits = std::vector<LifeUnit>;
 
+// Population of square blocks of cells, the block size doubles with every level.
+struct DensityLevel
+{
+  SizeT block_size_ = 0;
+  QPoint blocks_;
+  std::vector<uint32_t> population_;
+  std::vector<PlayerId> dominant_players_;
+};
+using DensityLevels = std::vector<DensityLevel>;
+
+// The generation published by the life processor, read on the thread stepping it
+// and valid until the next step. It keeps the view away from the engine field and
+// its sequence lets the reader notice skipped publications.
+struct LifeSnapshot
+{
+  virtual ~LifeSnapshot() = default;
+  // Grows by one with every published generation.
+  virtual uint64_t sequence() const = 0;
+  virtual LifeUnits const& lifeUnits() const = 0;
+  // Units inside the region, which is taken modulo the field size.
+  virtual LifeUnits lifeUnitsIn(QRect region) const = 0;
+  virtual DensityLevels const& densityLevels() const = 0;
+  // Tile rectangles, in cells, whose units differ from the snapshot sequence() - 1.
+  virtual QVector<QRect> const& changedRegions() const = 0;
+};
+
+// A pattern placement for the generation, numbered like LifeProcessor::generation(),
+// it lands on the first generation boundary not before it.
+struct PatternCommand
+{
+  PatternTrs pattern_trs_;
+  PlayerId player_ = 0;
+  StepId generation_ = 0;
+};
+
+enum class FieldFormat
+{
+  Rle,
+  // One bit per cell, see BinaryFieldWriter.
+  Binary,
+  // Hashed quadtree of the live cells, the players are dropped.
+  Macrocell,
+};
+
 struct LifeProcessor
 {
   virtual ~LifeProcessor() = default;
+  // Units of the last published generation, for the thread calling processLife().
   virtual LifeUnits const& lifeUnits() const = 0;
+  // The latest published generation, for the thread calling processLife().
+  virtual LifeSnapshot const& snapshot() = 0;
   virtual bool computed() const = 0;
   virtual int computationDuration() const = 0;
 
+  // Adding units discards the precomputed generations.
   virtual void addUnit(LifeUnit unit) = 0;
-  virtual void processLife(bool compute) = 0;
+  // Adds the pattern variant centered at the offset, the pattern wraps around the field.
+  virtual void stamp(Pattern const& pattern, PatternVariant variant, QPoint offset, PlayerId player) = 0;
+  // Any thread, never waits for the engine. Returns false when too many commands are pending.
+  virtual bool post(PatternCommand command) = 0;
+  // The earliest generation a placement made now can land on, the one following the
+  // published generation. On the thread calling processLife().
+  virtual StepId generation() const = 0;
+  // Returns false when no generation was published. Without computing nothing is
+  // published until the field changes, so a stopped game costs nothing.
+  virtual bool processLife(bool compute) = 0;
+  // Passes the next generation without extracting and publishing it.
+  // Returns false when the engine is busy.
+  virtual bool skipLife() = 0;
+  // Up to the given number of future generations are kept ready for processLife().
+  virtual void setLookahead(SizeT generations) = 0;
+  // Computes one more future generation when the engine is idle and the lookahead is not full.
+  virtual bool precompute() = 0;
+  // Nothing is left to precompute until processLife() takes a generation or the field changes.
+  virtual bool lookaheadFull() const = 0;
+  // Called on the engine thread after every generation once computed() is true, so
+  // it should only post to the thread stepping the processor. Once replaced the
+  // previous handler is never called again.
+  virtual void setComputedHandler(std::function<void()> handler) = 0;
+  // Writes the published generation, returns false when the device fails.
+  virtual bool exportField(QIODevice& device, FieldFormat format) = 0;
 };
 using LifeProcessorPtr = std::unique_ptr<LifeProcessor>;
 LifeProcessorPtr createLifeProcessor(QPoint field_size);
@@ -98,9 +227,14 @@ struct GameModel
   virtual QPoint cells() const = 0;
   virtual SizeT patternCount() const = 0;
   virtual PatternPtr patternAt(SizeT idx) const = 0;
+  // Catalog entries by the indices of patternAt(), known without parsing.
+  virtual Utilities::PatternsPtr patternCatalog() const = 0;
   virtual LifeUnits const& lifeUnits() const = 0;
+  virtual LifeSnapshot const& snapshot() const = 0;
 
   virtual LifeProcessor& lifeProcessor() = 0;
+  // The current generation, on the thread stepping the life processor.
+  virtual bool exportField(QIODevice& device, FieldFormat format) = 0;
 };
 using GameModelPtr = QSharedPointer<GameModel const>;
 using GameModelMutablePtr = QSharedPointer<GameModel>;
@@ -1,22 +1,40 @@
-#include <QThreadPool>
+#include <algorithm>
+#include <cstring>
+
 #include <QDebug>
+#include <QSettings>
 #include <QTime>
 
+#include "enginethreadpool.h"
+#include "fieldbuffer.h"
 #include "lifeprocessor.h"
 
 namespace Logic {
 
 namespace {
 
-using Buffer = std::vector<uint8_t>;
+using Buffer = FieldBuffer;
 using Point = QPoint;
 using Index = size_t;
+using Band = QPair<Index, Index>;
+
+// Huge pages once every worker gets at least one, a page shared by two bands
+// would land on one node only.
+Index bandPageSize(Index cells, int workers)
+{
+  return (cells >= FieldBuffer::c_huge_page_size * static_cast<Index>(workers))
+      ? FieldBuffer::c_huge_page_size : FieldBuffer::c_page_size;
+}
 
-QThreadPool& threadPool()
+// Page aligned cells of a worker. The same worker first touches and then computes
+// its band every generation, so on NUMA hosts it stays in the local memory.
+Band band(Index cells, Index page_size, int worker, int workers)
 {
-  auto* result = QThreadPool::globalInstance();
-  Q_ASSERT(result != nullptr);
-  return *result;
+  auto const pages = (cells + page_size - 1) / page_size;
+  auto const band_size = (pages + workers - 1) / static_cast<Index>(workers) * page_size;
+  auto const begin = std::min(cells, band_size * static_cast<Index>(worker));
+  auto const end = (worker + 1 == workers) ? cells : std::min(cells, begin + band_size);
+  return qMakePair(begin, end);
 }
 
 class LifeProcess
@@ -67,124 +85,95 @@ private:
   Index const height_ = 0;
 };
 
+EngineThreadPool::Params enginePoolParams()
+{
+  QSettings const settings("GoL", "CPULifeProcessor");
+  EngineThreadPool::Params params;
+  params.threads_ = settings.value("threads", params.threads_).toInt();
+  // Pinned by default where the memory is split between nodes.
+  params.pin_threads_ = settings.value("pinThreads", EngineThreadPool::numaNodes().size() > 1).toBool();
+  params.spin_iterations_ = settings.value("spinIterations", params.spin_iterations_).toInt();
+  return params;
+}
+
 class CPULifeProcessor final : public LifeProcessorImpl
 {
 public:
   explicit CPULifeProcessor(QPoint field_size)
     : LifeProcessorImpl(field_size)
-    , input_(field_size.x() * field_size.y())
-    , output_(field_size.x() * field_size.y())
+    , life_process_(field_size.x(), field_size.y())
+    , input_(static_cast<Index>(field_size.x() * field_size.y()))
+    , output_(static_cast<Index>(field_size.x() * field_size.y()))
+    , thread_pool_(enginePoolParams(),
+                   [this](int worker, int workers) { processChunk(worker, workers); },
+                   [this] { handleComputeCompletion(); },
+                   [this] { notifyComputed(); })
   {
-    qDebug() << "Active threads: " << threadPool().activeThreadCount()
-             << " Max threads: " << threadPool().maxThreadCount();
-    auto const thread_count = threadPool().maxThreadCount();
-    auto const chunk_size = (field_size.x() * field_size.y()) / thread_count;
-    for (int idx = 0; idx < thread_count; ++idx)
+    band_page_size_ = bandPageSize(input_.size(), thread_pool_.threadCount());
+    if (band_page_size_ == FieldBuffer::c_huge_page_size)
     {
-      auto const range = QPoint(chunk_size * idx, chunk_size * (idx + 1));
-      life_processes_.emplace_back(range, field_size, input_, output_, *this);
+      input_.adviseHugePages();
+      output_.adviseHugePages();
     }
+    thread_pool_.runAndWait([this](int worker, int workers)
+    {
+      auto const cells = band(input_.size(), band_page_size_, worker, workers);
+      std::memset(input_.data() + cells.first, 0, cells.second - cells.first);
+      std::memset(output_.data() + cells.first, 0, cells.second - cells.first);
+    });
   }
   ~CPULifeProcessor() override
   {
     while (!computed());
-    QMutexLocker locker(&mutex_);
   }
 
 public: // LifeProcessor
-  bool computed() const override;
+  bool computed() const override
+  {
+    return thread_pool_.idle();
+  }
   int computationDuration() const override
   {
     return last_computation_duration_;
   }
 
 protected: // LifeProcessorImpl
-  void processLife() override;
+  void processLife() override
+  {
+    computation_duration_.start();
+    thread_pool_.run();
+  }
   uint8_t* data() override
   {
     return input_.data();
   }
 
 private:
-  void handleComputeCompletion()
+  void processChunk(int worker, int workers)
   {
-    if (computed())
+    auto const cells = band(input_.size(), band_page_size_, worker, workers);
+    for (auto idx = cells.first; idx < cells.second; ++idx)
     {
-      input_.swap(output_);
-      last_computation_duration_ = computation_duration_.elapsed();
+      life_process_.lifeStep(input_, output_, idx);
     }
   }
-
-  class LifeProcessChunk;
-  std::vector<LifeProcessChunk> life_processes_;
-  std::vector<uint8_t> input_;
-  std::vector<uint8_t> output_;
-  QMutex mutex_;
-  QTime computation_duration_;
-  int last_computation_duration_ = 0;
-};
-
-class CPULifeProcessor::LifeProcessChunk final : public QRunnable
-{
-public:
-  explicit LifeProcessChunk(QPoint range, QPoint field_size, Buffer const& input, Buffer& output, CPULifeProcessor& processor)
-    : range_(range)
-    , life_process_(field_size.x(), field_size.y())
-    , input_(input)
-    , output_(output)
-    , processor_(processor)
-  {
-    setAutoDelete(false);
-  }
-
-  bool computed() const
-  {
-    return computed_;
-  }
-
-  void start()
-  {
-    Q_ASSERT(computed());
-    computed_ = false;
-    threadPool().start(this);
-  }
-  void run() override
+  void handleComputeCompletion()
   {
-    for (Index idx = range_.x(); idx < static_cast<Index>(range_.y()); ++idx)
-    {
-      life_process_.lifeStep(input_, output_, idx);
-    }
-    QMutexLocker locker(&processor_.mutex_);
-    computed_ = true;
-    processor_.handleComputeCompletion();
+    input_.swap(output_);
+    last_computation_duration_ = computation_duration_.elapsed();
+    generationComputed();
   }
 
-private:
-  QPoint const range_;
   LifeProcess const life_process_;
-  Buffer const& input_;
-  Buffer& output_;
-  CPULifeProcessor& processor_;
-  bool computed_ = true;
+  Buffer input_;
+  Buffer output_;
+  Index band_page_size_ = FieldBuffer::c_page_size;
+  QTime computation_duration_;
+  int last_computation_duration_ = 0;
+  // Declared last, so the workers stop before the buffers go away.
+  EngineThreadPool thread_pool_;
 };
 
-void CPULifeProcessor::processLife()
-{
-  computation_duration_.start();
-  for (auto& life_process : life_processes_)
-  {
-    life_process.start();
-  }
-}
-
-bool CPULifeProcessor::computed() const
-{
-  return std::all_of(life_processes_.begin(), life_processes_.end(), [](LifeProcessChunk const& chunk)
-  {
-    return chunk.computed();
-  });
-}
-
 } // namespace
 
 LifeProcessorPtr createCPULifeProcessor(QPoint field_size)
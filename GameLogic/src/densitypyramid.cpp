@@ -0,0 +1,91 @@
+#include <algorithm>
+
+#include "densitypyramid.h"
+
+namespace Logic {
+
+namespace {
+
+constexpr SizeT const c_base_block_size = 8;
+
+} // namespace
+
+DensityPyramid::DensityPyramid(QPoint field_size)
+{
+  auto block_size = std::min({ c_base_block_size, field_size.x(), field_size.y() });
+  while (true)
+  {
+    DensityLevel level;
+    level.block_size_ = block_size;
+    level.blocks_ = QPoint(field_size.x() / block_size, field_size.y() / block_size);
+    auto const block_count = static_cast<size_t>(level.blocks_.x() * level.blocks_.y());
+    level.population_.resize(block_count, 0);
+    level.dominant_players_.resize(block_count, 0);
+    levels_.push_back(std::move(level));
+
+    if (levels_.back().blocks_.x() == 1 || levels_.back().blocks_.y() == 1)
+    {
+      break;
+    }
+    block_size *= 2;
+  }
+  player_population_.resize(levels_.front().population_.size() * c_max_player_count, 0);
+}
+
+void DensityPyramid::rebuild(LifeUnits const& life_units)
+{
+  auto& base = levels_.front();
+  std::fill(base.population_.begin(), base.population_.end(), 0);
+  std::fill(player_population_.begin(), player_population_.end(), 0);
+  for (auto const unit : life_units)
+  {
+    auto const block = static_cast<size_t>(unit.x() / base.block_size_
+                                           + (unit.y() / base.block_size_) * base.blocks_.x());
+    ++base.population_[block];
+    ++player_population_[block * c_max_player_count + unit.player()];
+  }
+  for (size_t block = 0; block < base.population_.size(); ++block)
+  {
+    auto const* players = &player_population_[block * c_max_player_count];
+    base.dominant_players_[block] = static_cast<PlayerId>(
+          std::max_element(players, players + c_max_player_count) - players);
+  }
+
+  for (size_t level = 1; level < levels_.size(); ++level)
+  {
+    reduce(levels_[level - 1], levels_[level]);
+  }
+}
+
+// The dominant player of a block is the one of its most populated quarter,
+// exact per-player counts are kept for the base level only.
+void DensityPyramid::reduce(DensityLevel const& lower, DensityLevel& upper) const
+{
+  for (int y = 0; y < upper.blocks_.y(); ++y)
+  {
+    for (int x = 0; x < upper.blocks_.x(); ++x)
+    {
+      uint32_t population = 0;
+      uint32_t max_population = 0;
+      PlayerId dominant_player = 0;
+      for (int child = 0; child < 4; ++child)
+      {
+        auto const child_x = 2 * x + child % 2;
+        auto const child_y = 2 * y + child / 2;
+        auto const idx = static_cast<size_t>(child_x + child_y * lower.blocks_.x());
+        auto const child_population = lower.population_[idx];
+        population += child_population;
+        if (child_population > max_population)
+        {
+          max_population = child_population;
+          dominant_player = lower.dominant_players_[idx];
+        }
+      }
+      auto const idx = static_cast<size_t>(x + y * upper.blocks_.x());
+      upper.population_[idx] = population;
+      upper.dominant_players_[idx] = dominant_player;
+    }
+  }
+}
+
+} // Logic
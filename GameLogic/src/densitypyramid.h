@@ -0,0 +1,28 @@
+#ifndef DENSITYPYRAMID_H
+#define DENSITYPYRAMID_H
+
+#include "../gamemodel.h"
+
+namespace Logic {
+
+class DensityPyramid
+{
+public:
+  explicit DensityPyramid(QPoint field_size);
+
+  void rebuild(LifeUnits const& life_units);
+  DensityLevels const& levels() const
+  {
+    return levels_;
+  }
+
+private:
+  void reduce(DensityLevel const& lower, DensityLevel& upper) const;
+
+  DensityLevels levels_;
+  std::vector<uint8_t> player_population_;
+};
+
+} // Logic
+
+#endif // DENSITYPYRAMID_H
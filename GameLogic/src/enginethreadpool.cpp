@@ -0,0 +1,225 @@
+#include <algorithm>
+
+#include <QtGlobal>
+#include <QDebug>
+
+#if defined(Q_OS_LINUX)
+#include <pthread.h>
+#include <QDir>
+#include <QFile>
+#endif
+
+#include "enginethreadpool.h"
+
+namespace Logic {
+
+namespace {
+
+#if defined(Q_OS_LINUX)
+// A sysfs cpulist, like "0-7,16-23".
+std::vector<int> parseCpuList(QByteArray const& list)
+{
+  std::vector<int> cpus;
+  for (auto const& range : list.trimmed().split(','))
+  {
+    auto const bounds = range.split('-');
+    auto first_ok = false;
+    auto last_ok = false;
+    auto const first = bounds.front().toInt(&first_ok);
+    auto const last = bounds.back().toInt(&last_ok);
+    if (!first_ok || !last_ok)
+    {
+      continue;
+    }
+    for (auto cpu = first; cpu <= last; ++cpu)
+    {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+#endif
+
+} // namespace
+
+EngineThreadPool::EngineThreadPool(Params const& params, Task task, Completion completion,
+                                   Completion idle_handler)
+  : params_(params)
+  , nodes_(numaNodes())
+  , task_(std::move(task))
+  , completion_(std::move(completion))
+  , idle_handler_(std::move(idle_handler))
+{
+  auto const hardware_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  auto const thread_count = params_.threads_ > 0 ? params_.threads_ : hardware_threads;
+  threads_.reserve(static_cast<size_t>(thread_count));
+  for (int worker = 0; worker < thread_count; ++worker)
+  {
+    threads_.emplace_back(&EngineThreadPool::work, this, worker);
+  }
+  qDebug() << "Engine threads:" << thread_count << "pinned:" << params_.pin_threads_
+           << "NUMA nodes:" << nodes_.size() << "spin iterations:" << params_.spin_iterations_;
+}
+
+EngineThreadPool::~EngineThreadPool()
+{
+  {
+    QMutexLocker locker(&mutex_);
+    stopping_ = true;
+  }
+  wake_.wakeAll();
+  for (auto& thread : threads_)
+  {
+    thread.join();
+  }
+}
+
+void EngineThreadPool::run()
+{
+  start(&task_);
+}
+
+void EngineThreadPool::runAndWait(Task const& task)
+{
+  start(&task);
+  while (!idle())
+  {
+    std::this_thread::yield();
+  }
+}
+
+void EngineThreadPool::start(Task const* task)
+{
+  Q_ASSERT(idle());
+  current_task_ = task;
+  busy_.store(true, std::memory_order_relaxed);
+  remaining_.store(threadCount(), std::memory_order_relaxed);
+  {
+    QMutexLocker locker(&mutex_);
+    run_.fetch_add(1, std::memory_order_release);
+  }
+  wake_.wakeAll();
+}
+
+void EngineThreadPool::work(int worker)
+{
+  if (params_.pin_threads_)
+  {
+    pin(worker);
+  }
+  uint64_t last_run = 0;
+  for (;;)
+  {
+    last_run = waitForRun(last_run);
+    if (stopping_)
+    {
+      return;
+    }
+    auto const* task = current_task_;
+    (*task)(worker, threadCount());
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      auto const engine_task = task == &task_;
+      if (engine_task)
+      {
+        completion_();
+      }
+      busy_.store(false, std::memory_order_release);
+      if (engine_task && idle_handler_)
+      {
+        idle_handler_();
+      }
+    }
+  }
+}
+
+// Generations usually follow each other closely, so a worker polls for the next run
+// before it pays for a sleep and a wake up.
+uint64_t EngineThreadPool::waitForRun(uint64_t last_run)
+{
+  for (int iteration = 0; iteration < params_.spin_iterations_; ++iteration)
+  {
+    auto const run = run_.load(std::memory_order_acquire);
+    if (run != last_run || stopping_)
+    {
+      return run;
+    }
+    std::this_thread::yield();
+  }
+
+  QMutexLocker locker(&mutex_);
+  while (run_.load(std::memory_order_acquire) == last_run && !stopping_)
+  {
+    wake_.wait(&mutex_);
+  }
+  return run_.load(std::memory_order_acquire);
+}
+
+std::vector<std::vector<int>> EngineThreadPool::numaNodes()
+{
+  std::vector<std::vector<int>> nodes;
+#if defined(Q_OS_LINUX)
+  QDir const sysfs("/sys/devices/system/node");
+  auto node_dirs = sysfs.entryList({ "node*" }, QDir::Dirs);
+  std::sort(node_dirs.begin(), node_dirs.end(), [](QString const& lhs, QString const& rhs)
+  {
+    return lhs.midRef(4).toInt() < rhs.midRef(4).toInt();
+  });
+  for (auto const& node_dir : node_dirs)
+  {
+    QFile list(sysfs.filePath(node_dir + "/cpulist"));
+    if (list.open(QIODevice::ReadOnly))
+    {
+      auto cpus = parseCpuList(list.readAll());
+      if (!cpus.empty())
+      {
+        nodes.push_back(std::move(cpus));
+      }
+    }
+  }
+#endif
+  if (nodes.empty())
+  {
+    auto const hardware_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    nodes.emplace_back();
+    for (int cpu = 0; cpu < hardware_threads; ++cpu)
+    {
+      nodes.back().push_back(cpu);
+    }
+  }
+  return nodes;
+}
+
+// The workers of a node are kept on all of its CPUs, the band they first touch
+// is allocated there. A single node host pins every worker to its own CPU.
+void EngineThreadPool::pin(int worker)
+{
+#if defined(Q_OS_LINUX)
+  auto const workers = threadCount();
+  auto const node_count = static_cast<int>(nodes_.size());
+  auto const node = static_cast<size_t>(worker * node_count / workers);
+  auto const& node_cpus = nodes_[node];
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  if (node_count == 1)
+  {
+    CPU_SET(node_cpus[static_cast<size_t>(worker) % node_cpus.size()], &cpus);
+  }
+  else
+  {
+    for (auto const cpu : node_cpus)
+    {
+      CPU_SET(cpu, &cpus);
+    }
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+  {
+    qDebug() << "Impossible to pin engine thread" << worker;
+  }
+#else
+  Q_UNUSED(worker);
+  qDebug() << "Engine thread affinity is not supported on this platform";
+#endif
+}
+
+} // Logic
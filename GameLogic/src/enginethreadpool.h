@@ -0,0 +1,78 @@
+#ifndef ENGINETHREADPOOL_H
+#define ENGINETHREADPOOL_H
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <QMutex>
+#include <QWaitCondition>
+
+namespace Logic {
+
+// Workers owned by one engine, so nothing else queued in Qt thread pools can delay
+// a generation. Every run() calls the task once on each worker and the completion
+// on the worker finishing last, then the idle handler once the pool reports idle().
+// Idle workers spin for a while before parking.
+class EngineThreadPool
+{
+public:
+  struct Params
+  {
+    // Zero means one worker per hardware thread.
+    int threads_ = 0;
+    // Workers are spread over the NUMA nodes in order, so consecutive workers share
+    // a node, and kept on its CPUs.
+    bool pin_threads_ = false;
+    int spin_iterations_ = 20000;
+  };
+  using Task = std::function<void(int worker, int workers)>;
+  using Completion = std::function<void()>;
+
+  explicit EngineThreadPool(Params const& params, Task task, Completion completion,
+                            Completion idle_handler = Completion());
+  ~EngineThreadPool();
+
+  EngineThreadPool(EngineThreadPool const&) = delete;
+  EngineThreadPool& operator = (EngineThreadPool const&) = delete;
+
+  int threadCount() const
+  {
+    return static_cast<int>(threads_.size());
+  }
+  bool idle() const
+  {
+    return !busy_.load(std::memory_order_acquire);
+  }
+  void run();
+  // Calls the task once on every worker instead of the engine task and waits for it.
+  void runAndWait(Task const& task);
+
+  // CPUs of every NUMA node, a single node with every CPU when unknown.
+  static std::vector<std::vector<int>> numaNodes();
+
+private:
+  void work(int worker);
+  uint64_t waitForRun(uint64_t last_run);
+  void pin(int worker);
+  void start(Task const* task);
+
+  Params const params_;
+  std::vector<std::vector<int>> const nodes_;
+  Task const task_;
+  Completion const completion_;
+  Completion const idle_handler_;
+  std::vector<std::thread> threads_;
+  Task const* current_task_ = nullptr;
+  std::atomic<uint64_t> run_ { 0 };
+  std::atomic<int> remaining_ { 0 };
+  std::atomic<bool> busy_ { false };
+  std::atomic<bool> stopping_ { false };
+  QMutex mutex_;
+  QWaitCondition wake_;
+};
+
+} // Logic
+
+#endif // ENGINETHREADPOOL_H
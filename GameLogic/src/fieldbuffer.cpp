@@ -0,0 +1,72 @@
+#include <new>
+#include <utility>
+
+#include <QtGlobal>
+
+#if defined(Q_OS_LINUX)
+#include <sys/mman.h>
+#endif
+
+#include "fieldbuffer.h"
+
+namespace Logic {
+
+namespace {
+
+size_t roundUp(size_t value, size_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+// Anonymous mappings get physical pages on the first write only. The mapping is
+// one huge page longer than needed, so the cells can start at a huge page boundary.
+FieldBuffer::FieldBuffer(size_t size)
+  : size_(size)
+{
+  auto const aligned_size = roundUp(size_, c_huge_page_size);
+#if defined(Q_OS_LINUX)
+  mapped_size_ = aligned_size + c_huge_page_size;
+  mapping_ = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping_ == MAP_FAILED)
+  {
+    throw std::bad_alloc();
+  }
+  auto const address = reinterpret_cast<uintptr_t>(mapping_);
+  data_ = reinterpret_cast<uint8_t*>(roundUp(address, c_huge_page_size));
+#else
+  mapping_ = qMallocAligned(aligned_size, c_huge_page_size);
+  if (mapping_ == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  data_ = static_cast<uint8_t*>(mapping_);
+#endif
+}
+
+FieldBuffer::~FieldBuffer()
+{
+#if defined(Q_OS_LINUX)
+  munmap(mapping_, mapped_size_);
+#else
+  qFreeAligned(mapping_);
+#endif
+}
+
+void FieldBuffer::adviseHugePages()
+{
+#if defined(Q_OS_LINUX)
+  madvise(data_, mapped_size_ - c_huge_page_size, MADV_HUGEPAGE);
+#endif
+}
+
+void FieldBuffer::swap(FieldBuffer& other)
+{
+  std::swap(size_, other.size_);
+  std::swap(mapped_size_, other.mapped_size_);
+  std::swap(mapping_, other.mapping_);
+  std::swap(data_, other.data_);
+}
+
+} // Logic
@@ -0,0 +1,57 @@
+#ifndef FIELDBUFFER_H
+#define FIELDBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Logic {
+
+// Cells of one engine buffer, aligned to huge pages and left untouched by the
+// allocation, so every page lands on the memory node of the thread writing it first.
+class FieldBuffer
+{
+public:
+  static constexpr size_t const c_page_size = 4096;
+  static constexpr size_t const c_huge_page_size = 2 * 1024 * 1024;
+
+  explicit FieldBuffer(size_t size);
+  ~FieldBuffer();
+
+  FieldBuffer(FieldBuffer const&) = delete;
+  FieldBuffer& operator = (FieldBuffer const&) = delete;
+
+  uint8_t* data()
+  {
+    return data_;
+  }
+  uint8_t const* data() const
+  {
+    return data_;
+  }
+  size_t size() const
+  {
+    return size_;
+  }
+  uint8_t& operator [] (size_t idx)
+  {
+    return data_[idx];
+  }
+  uint8_t operator [] (size_t idx) const
+  {
+    return data_[idx];
+  }
+  void swap(FieldBuffer& other);
+  // Backs the cells with transparent huge pages where the system has them. Only
+  // for buffers split between threads at huge page boundaries, before the first write.
+  void adviseHugePages();
+
+private:
+  size_t size_ = 0;
+  size_t mapped_size_ = 0;
+  void* mapping_ = nullptr;
+  uint8_t* data_ = nullptr;
+};
+
+} // Logic
+
+#endif // FIELDBUFFER_H
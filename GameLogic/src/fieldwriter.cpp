@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cstring>
+
+#include <QtEndian>
+
+#include "fieldwriter.h"
+
+namespace Logic {
+
+namespace {
+
+constexpr int const c_buffer_size = 1 << 20;
+constexpr int const c_rle_line_size = 70;
+constexpr char const c_binary_magic[] = { 'G', 'o', 'L', 'F' };
+constexpr quint32 const c_binary_version = 1;
+constexpr int const c_word_bits = 64;
+
+bool writeU32(QIODevice& device, quint32 value)
+{
+  uchar bytes[sizeof(value)];
+  qToLittleEndian(value, bytes);
+  return device.write(reinterpret_cast<char const*>(bytes), sizeof(bytes)) == sizeof(bytes);
+}
+
+} // namespace
+
+RleFieldWriter::RleFieldWriter(QIODevice& device, QPoint field_size)
+  : device_(device)
+{
+  buffer_.reserve(c_buffer_size + c_rle_line_size);
+  buffer_ += "#N GoL field\n";
+  buffer_ += QString("x = %1, y = %2, rule = B3/S23\n").arg(field_size.x()).arg(field_size.y()).toUtf8();
+}
+
+void RleFieldWriter::operator()(int x, int y, int length, uint8_t state)
+{
+  Q_ASSERT(state > 0);
+  Q_UNUSED(state);
+  if (y > position_.y())
+  {
+    write(y - position_.y(), '$');
+    position_ = QPoint(0, y);
+  }
+  if (x > position_.x())
+  {
+    write(x - position_.x(), 'b');
+  }
+  write(length, 'o');
+  position_.setX(x + length);
+}
+
+bool RleFieldWriter::finish()
+{
+  write(1, '!');
+  buffer_ += '\n';
+  flush();
+  return ok_;
+}
+
+void RleFieldWriter::write(int count, char tag)
+{
+  char token[16];
+  auto size = 0;
+  if (count > 1)
+  {
+    char digits[12];
+    auto digit_count = 0;
+    for (; count > 0; count /= 10)
+    {
+      digits[digit_count++] = static_cast<char>('0' + count % 10);
+    }
+    std::reverse_copy(digits, digits + digit_count, token);
+    size = digit_count;
+  }
+  token[size++] = tag;
+
+  if (line_size_ + size > c_rle_line_size)
+  {
+    buffer_ += '\n';
+    line_size_ = 0;
+  }
+  buffer_.append(token, size);
+  line_size_ += size;
+  if (buffer_.size() >= c_buffer_size)
+  {
+    flush();
+  }
+}
+
+void RleFieldWriter::flush()
+{
+  ok_ = ok_ && device_.write(buffer_) == buffer_.size();
+  buffer_.resize(0);
+}
+
+BinaryFieldWriter::BinaryFieldWriter(QIODevice& device, QPoint field_size)
+  : device_(device)
+  , field_size_(field_size)
+  , row_(static_cast<size_t>((field_size.x() + c_word_bits - 1) / c_word_bits), 0)
+{
+  buffer_.reserve(c_buffer_size + static_cast<int>(row_.size() * sizeof(uint64_t)));
+  ok_ = device_.write(c_binary_magic, sizeof(c_binary_magic)) == sizeof(c_binary_magic)
+      && writeU32(device_, c_binary_version)
+      && writeU32(device_, static_cast<quint32>(field_size.x()))
+      && writeU32(device_, static_cast<quint32>(field_size.y()));
+}
+
+void BinaryFieldWriter::operator()(int x, int y, int length, uint8_t)
+{
+  writeRowsUpTo(y);
+  while (length > 0)
+  {
+    auto const offset = x % c_word_bits;
+    auto const count = std::min(length, c_word_bits - offset);
+    auto const mask = (count == c_word_bits) ? ~uint64_t(0) : ((uint64_t(1) << count) - 1);
+    row_[static_cast<size_t>(x / c_word_bits)] |= mask << offset;
+    x += count;
+    length -= count;
+  }
+}
+
+bool BinaryFieldWriter::finish()
+{
+  writeRowsUpTo(field_size_.y());
+  flush();
+  return ok_;
+}
+
+// Buffers the filled row and the empty ones up to y.
+void BinaryFieldWriter::writeRowsUpTo(int y)
+{
+  auto const row_bytes = static_cast<int>(row_.size() * sizeof(uint64_t));
+  for (; row_y_ < y && ok_; ++row_y_)
+  {
+    for (auto& word : row_)
+    {
+      word = qToLittleEndian(word);
+    }
+    buffer_.append(reinterpret_cast<char const*>(row_.data()), row_bytes);
+    std::fill(row_.begin(), row_.end(), 0);
+    if (buffer_.size() >= c_buffer_size)
+    {
+      flush();
+    }
+  }
+}
+
+void BinaryFieldWriter::flush()
+{
+  ok_ = ok_ && device_.write(buffer_) == buffer_.size();
+  buffer_.resize(0);
+}
+
+} // Logic
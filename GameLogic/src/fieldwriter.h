@@ -0,0 +1,63 @@
+#ifndef FIELDWRITER_H
+#define FIELDWRITER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QPoint>
+
+namespace Logic {
+
+// Both writers take the live runs of a field a row at a time with growing columns,
+// rows counted from the top as in RLE files, and stream them to the device through
+// a buffer, the field is never held whole.
+
+// RLE with lines of at most 70 characters. Every live cell is written as 'o',
+// the players are dropped so the B3/S23 rule loads anywhere.
+class RleFieldWriter
+{
+public:
+  explicit RleFieldWriter(QIODevice& device, QPoint field_size);
+
+  void operator()(int x, int y, int length, uint8_t state);
+  // False when the device failed.
+  bool finish();
+
+private:
+  void write(int count, char tag);
+  void flush();
+
+  QIODevice& device_;
+  QByteArray buffer_;
+  QPoint position_;
+  int line_size_ = 0;
+  bool ok_ = true;
+};
+
+// "GoLF", version, width and height as little-endian 32-bit numbers, then every
+// row as little-endian 64-bit words, bit n of a word is the column n in it.
+class BinaryFieldWriter
+{
+public:
+  explicit BinaryFieldWriter(QIODevice& device, QPoint field_size);
+
+  void operator()(int x, int y, int length, uint8_t state);
+  bool finish();
+
+private:
+  void writeRowsUpTo(int y);
+  void flush();
+
+  QIODevice& device_;
+  QPoint const field_size_;
+  std::vector<uint64_t> row_;
+  int row_y_ = 0;
+  QByteArray buffer_;
+  bool ok_ = true;
+};
+
+} // Logic
+
+#endif // FIELDWRITER_H
@@ -1,35 +1,414 @@
+#include <algorithm>
+#include <cstring>
+#include <random>
+
 #include <QDebug>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QSettings>
+#include <QSysInfo>
+#include <QtAlgorithms>
 
+#include "../../Utilities/macrocell.h"
+#include "../../Utilities/rleparser.h"
+#include "fieldwriter.h"
 #include "lifeprocessor.h"
 
 namespace Logic {
 
+namespace {
+
+constexpr auto const c_calibration_generations = 8;
+// Per engine, the calibration runs while the game model is built on the GUI thread.
+constexpr auto const c_calibration_time_limit = 100;
+constexpr auto const c_calibration_density = 0.3;
+constexpr auto const* c_calibration_group = "LifeProcessorCalibration";
+// Bumped when the engines or the benchmark change, the stored choices are dropped then.
+constexpr auto const c_calibration_version = 2;
+constexpr uint64_t const c_low_bytes = 0x0101010101010101;
+constexpr uint64_t const c_gather_low_bits = 0x0102040810204080;
+constexpr size_t const c_words_per_chunk = 8;
+
+struct Engine
+{
+  char const* name_;
+  LifeProcessorPtr (*create_)(QPoint field_size);
+};
+
+Engine const c_engines[] =
+{
+  { "GPU", &createGPULifeProcessor },
+  { "CPU", &createCPULifeProcessor },
+};
+
+void waitComputed(LifeProcessor const& processor)
+{
+  while (!processor.computed());
+}
+
+// Returns generations per second on a random soup, including the live units extraction
+// because the game pays for it every step. Negative when the engine is not available.
+// The first generation is timed apart, it bounds the next ones to the time limit
+// and is the whole measure when none of them fits.
+qreal benchmark(Engine const& engine, QPoint field_size)
+{
+  LifeProcessorPtr processor;
+  try
+  {
+    processor = engine.create_(field_size);
+  }
+  catch(std::exception const& e)
+  {
+    qDebug() << "Impossible to create" << engine.name_ << "LifeProcessor!" << e.what();
+    return -1.0;
+  }
+
+  // Every engine is a LifeProcessorImpl, the soup is written in a single field change.
+  static_cast<LifeProcessorImpl&>(*processor).fillRandom(c_calibration_density,
+    static_cast<uint64_t>(field_size.x() ^ field_size.y()));
+
+  waitComputed(*processor);
+  QElapsedTimer timer;
+  timer.start();
+  processor->processLife(true);
+  waitComputed(*processor);
+  auto const first_generation = std::max<qint64>(timer.elapsed(), 1);
+
+  timer.restart();
+  auto generations = 0;
+  while (generations < c_calibration_generations
+         && timer.elapsed() + first_generation <= c_calibration_time_limit)
+  {
+    processor->processLife(true);
+    waitComputed(*processor);
+    ++generations;
+  }
+  if (generations == 0)
+  {
+    return 1000.0 / first_generation;
+  }
+  auto const elapsed = std::max<qint64>(timer.elapsed(), 1);
+  return generations * 1000.0 / elapsed;
+}
+
+QString calibrationKey(QPoint field_size)
+{
+  return QString("%1/%2/%3x%4")
+      .arg(QSysInfo::machineHostName())
+      .arg(QSysInfo::currentCpuArchitecture())
+      .arg(field_size.x())
+      .arg(field_size.y());
+}
+
+// Drops the choices stored by another calibration version, deleting the group
+// from the settings also makes the next start calibrate again.
+void checkCalibrationVersion(QSettings& settings)
+{
+  if (settings.value("version").toInt() != c_calibration_version)
+  {
+    settings.remove("");
+    settings.setValue("version", c_calibration_version);
+  }
+}
+
+Engine const* findEngine(QString const& name)
+{
+  for (auto const& engine : c_engines)
+  {
+    if (name == engine.name_)
+    {
+      return &engine;
+    }
+  }
+  return nullptr;
+}
+
+Engine const* calibrate(QPoint field_size)
+{
+  QSettings settings("GoL", c_calibration_group);
+  settings.beginGroup(calibrationKey(field_size));
+
+  Engine const* winner = nullptr;
+  qreal winner_rate = 0.0;
+  for (auto const& engine : c_engines)
+  {
+    auto const rate = benchmark(engine, field_size);
+    qDebug() << engine.name_ << "LifeProcessor calibration" << field_size << ":" << rate << "generations/s";
+    settings.setValue(QString(engine.name_) + "/rate", rate);
+    if (rate > winner_rate)
+    {
+      winner = &engine;
+      winner_rate = rate;
+    }
+  }
+  if (winner != nullptr)
+  {
+    settings.setValue("engine", winner->name_);
+  }
+  return winner;
+}
+
+} // namespace
+
 void LifeProcessorImpl::addUnit(LifeUnit unit)
 {
   auto const position = unit.x() + unit.y() * field_size_.y();
-  Q_ASSERT(computed());
   Q_ASSERT(position < fieldSize());
+  beginFieldChange();
   data()[position] = unit.player() + 1;
+  endFieldChange(unit.y(), 1);
 }
 
-void LifeProcessorImpl::processLife(bool compute)
+// Every engine keeps its field in data() between generations, so the bitmap words
+// are written there directly, wrapping the rows and columns past the field edges.
+void LifeProcessorImpl::stamp(Pattern const& pattern, PatternVariant variant, QPoint offset, PlayerId player)
 {
-  if (!computed())
+  Q_ASSERT(variant < c_pattern_variants);
+  Q_ASSERT(player < c_max_player_count);
+  auto const& bitmap = pattern.bitmap(variant);
+  auto const top_left = loopPos(offset + bitmap.origin_, field_size_);
+  auto const value = static_cast<uint8_t>(player + 1);
+
+  beginFieldChange();
+  auto* field = data();
+  for (size_t idx = 0; idx < bitmap.words_.size(); ++idx)
   {
-    return;
+    auto* line = field + ((top_left.y() + bitmap.rows_[idx]) % field_size_.y()) * field_size_.x();
+    auto const first_column = top_left.x() + static_cast<int>(bitmap.columns_[idx]);
+    for (auto bits = bitmap.words_[idx]; bits != 0; bits &= bits - 1)
+    {
+      auto const column = first_column + static_cast<int>(qCountTrailingZeroBits(bits));
+      line[column < field_size_.x() ? column : column % field_size_.x()] = value;
+    }
+  }
+  endFieldChange(top_left.y(), std::min(bitmap.size_.y(), field_size_.y()));
+}
+
+// Eight cells are decided by every random word, one byte each against the density.
+void LifeProcessorImpl::fillRandom(qreal density, uint64_t seed)
+{
+  Q_ASSERT(density >= 0.0 && density <= 1.0);
+  Q_ASSERT(static_cast<size_t>(fieldSize()) % sizeof(uint64_t) == 0);
+  auto const threshold = static_cast<uint64_t>(density * 256.0);
+  std::mt19937_64 random(seed);
+
+  beginFieldChange();
+  auto* field = data();
+  for (SizeT idx = 0; idx < fieldSize(); idx += sizeof(uint64_t))
+  {
+    auto const bytes = random();
+    for (size_t byte = 0; byte < sizeof(uint64_t); ++byte)
+    {
+      field[idx + byte] = (bytes >> (byte * 8) & 0xFF) < threshold ? 1 : 0;
+    }
   }
+  endFieldChange(0, field_size_.y());
+}
+
+bool LifeProcessorImpl::processLife(bool compute)
+{
+  if (computed())
+  {
+    applyCommands();
+  }
+  if (compute && !lookahead_.empty())
+  {
+    snapshot_.mutableLifeUnits().swap(lookahead_.front());
+    lookahead_.pop_front();
+    publish();
+    return true;
+  }
+  // A field change rewinds and drops the lookahead, while it is kept the published
+  // generation is unchanged and the engine field is ahead of it.
+  if (!computed() || (!compute && (field_published_ || !lookahead_.empty())))
+  {
+    return false;
+  }
+  Q_ASSERT(lookahead_.empty());
   prepareLifeUnits();
   if (compute)
   {
-    processLife();
+    startComputation(true);
+  }
+  return true;
+}
+
+bool LifeProcessorImpl::skipLife()
+{
+  if (computed())
+  {
+    applyCommands();
+  }
+  if (!lookahead_.empty())
+  {
+    lookahead_.pop_front();
+    return true;
+  }
+  if (!computed())
+  {
+    return false;
+  }
+  startComputation(false);
+  return true;
+}
+
+bool LifeProcessorImpl::precompute()
+{
+  if (!computed())
+  {
+    return false;
   }
+  applyCommands();
+  if (lookahead_.size() >= lookahead_limit_)
+  {
+    return false;
+  }
+  lookahead_.emplace_back();
+  takeFieldUnits(lookahead_.back());
+  startComputation(true);
+  return true;
 }
 
 void LifeProcessorImpl::prepareLifeUnits()
+{
+  takeFieldUnits(snapshot_.mutableLifeUnits());
+  publish();
+  field_published_ = true;
+}
+
+// Generations computed for the lookahead or the display are extracted by the
+// engine, only changed or turbo fields are left to the calling thread.
+void LifeProcessorImpl::takeFieldUnits(LifeUnits& life_units)
+{
+  if (field_extracted_)
+  {
+    life_units.swap(field_units_);
+    field_extracted_ = false;
+    return;
+  }
+  syncField();
+  extractLifeUnits(life_units);
+}
+
+void LifeProcessorImpl::generationComputed()
+{
+  if (field_wanted_)
+  {
+    extractLifeUnits(field_units_);
+    field_extracted_ = true;
+  }
+}
+
+void LifeProcessorImpl::notifyComputed()
+{
+  QMutexLocker lock(&computed_handler_mutex_);
+  if (computed_handler_)
+  {
+    computed_handler_();
+  }
+}
+
+// Commands are taken from the ring at generation boundaries only, while the engine
+// is idle, and the ones made for a generation after the one they would land on,
+// the engine field once rewound, wait for it.
+void LifeProcessorImpl::applyCommands()
+{
+  Q_ASSERT(computed());
+  PatternCommand command;
+  while (commands_.pop(command))
+  {
+    pending_commands_.push_back(std::move(command));
+  }
+  auto const due = std::stable_partition(pending_commands_.begin(), pending_commands_.end(),
+    [this](PatternCommand const& pending)
+  {
+    return pending.generation_ > generation();
+  });
+  for (auto iter = due; iter != pending_commands_.end(); ++iter)
+  {
+    apply(*iter);
+  }
+  pending_commands_.erase(due, pending_commands_.end());
+}
+
+void LifeProcessorImpl::apply(PatternCommand const& command)
+{
+  auto const& pattern = command.pattern_trs_.first;
+  auto const& trs = command.pattern_trs_.second;
+  Q_ASSERT(pattern != nullptr);
+  auto const variant = patternVariant(trs);
+  if (variant < c_pattern_variants)
+  {
+    stamp(*pattern, variant, QPoint(qRound(trs.dx()), qRound(trs.dy())), command.player_);
+    return;
+  }
+  for (auto const& unit : pattern->points())
+  {
+    auto const position = loopPos(unit * trs, field_size_);
+    addUnit(LifeUnit(static_cast<uint16_t>(position.x()),
+                     static_cast<uint16_t>(position.y()), command.player_));
+  }
+}
+
+void LifeProcessorImpl::beginFieldChange()
+{
+  Q_ASSERT(computed());
+  if (!lookahead_.empty())
+  {
+    rewind();
+  }
+  else
+  {
+    syncField();
+  }
+}
+
+void LifeProcessorImpl::endFieldChange(int first_row, int rows)
+{
+  field_published_ = false;
+  field_extracted_ = false;
+  fieldChanged(first_row, rows);
+}
+
+// Turbo generations are never extracted, so the engine may keep them to itself.
+void LifeProcessorImpl::startComputation(bool field_wanted)
+{
+  field_published_ = false;
+  field_extracted_ = false;
+  field_wanted_ = field_wanted;
+  ++field_generation_;
+  processLife();
+}
+
+void LifeProcessorImpl::publish()
+{
+  snapshot_.rebuild();
+}
+
+// Brings the engine field back to the first precomputed generation, which is
+// the next one to be published, and drops the rest of them. Its units are the
+// extraction of the restored field.
+void LifeProcessorImpl::rewind()
+{
+  Q_ASSERT(computed());
+  auto* field = data();
+  std::fill(field, field + fieldSize(), 0);
+  for (auto const unit : lookahead_.front())
+  {
+    field[unit.x() + unit.y() * field_size_.y()] = static_cast<uint8_t>(unit.player() + 1);
+  }
+  field_generation_ -= lookahead_.size();
+  field_units_.swap(lookahead_.front());
+  field_extracted_ = true;
+  lookahead_.clear();
+  fieldChanged(0, field_size_.y());
+}
+
+void LifeProcessorImpl::extractLifeUnits(LifeUnits& life_units)
 {
   using VecType = uint64_t;
 
-  life_units_.clear();
+  life_units.clear();
 
   Q_ASSERT(static_cast<size_t>(fieldSize()) % sizeof(VecType) == 0);
   auto const* begin = reinterpret_cast<VecType const*>(data());
@@ -50,7 +429,7 @@ void LifeProcessorImpl::prepareLifeUnits()
         auto const idx = index + byte;
         auto const x = static_cast<uint16_t>(idx % field_size_.x());
         auto const y = static_cast<uint16_t>(idx / field_size_.y());
-        life_units_.emplace_back(LifeUnit(x, y));
+        life_units.emplace_back(LifeUnit(x, y, static_cast<PlayerId>(life - 1)));
       }
     }
   }
@@ -58,14 +437,201 @@ void LifeProcessorImpl::prepareLifeUnits()
 
 LifeProcessorPtr createLifeProcessor(QPoint field_size)
 {
+  QSettings settings("GoL", c_calibration_group);
+  checkCalibrationVersion(settings);
+  auto const key = calibrationKey(field_size);
+  auto const* engine = findEngine(settings.value(key + "/engine").toString());
+  if (engine == nullptr)
+  {
+    engine = calibrate(field_size);
+  }
+  else
+  {
+    qDebug() << "Calibrated LifeProcessor for" << key << ":" << engine->name_
+             << settings.value(key + "/" + engine->name_ + "/rate").toReal() << "generations/s";
+  }
+
   try
   {
-    return createGPULifeProcessor(field_size);
+    if (engine != nullptr)
+    {
+      return engine->create_(field_size);
+    }
   }
   catch(std::exception const& e)
   {
-    qDebug() << "Impossible to create GPULifeProcessor! " << e.what();
-    return createCPULifeProcessor(field_size);
+    qDebug() << "Impossible to create" << engine->name_ << "LifeProcessor!" << e.what();
+  }
+  return createCPULifeProcessor(field_size);
+}
+
+bool LifeProcessorImpl::exportField(QIODevice& device, FieldFormat format)
+{
+  switch (format)
+  {
+  case FieldFormat::Rle:
+  {
+    Q_ASSERT(rleRoundTrips());
+    RleFieldWriter writer(device, field_size_);
+    readRuns(writer);
+    return writer.finish();
+  }
+  case FieldFormat::Binary:
+  {
+    BinaryFieldWriter writer(device, field_size_);
+    readRuns(writer);
+    return writer.finish();
+  }
+  case FieldFormat::Macrocell:
+  {
+    // Equal leaves are shared, the tree stays far smaller than the field.
+    Utilities::MacrocellWriter writer;
+    auto add_run = [&writer](int x, int y, int length, uint8_t)
+    {
+      writer.addRun(x, y, length);
+    };
+    readRuns(add_run);
+    auto const bytes = writer.write("GoL field");
+    return device.write(bytes) == bytes.size();
+  }
+  }
+  Q_ASSERT(false);
+  return false;
+}
+
+// The exported RLE is read back as a pattern, its points are the published units
+// once the rows are flipped back and the pattern center moved to the field origin.
+bool LifeProcessorImpl::rleRoundTrips()
+{
+  auto const& life_units = snapshot_.lifeUnits();
+  if (life_units.empty())
+  {
+    return true;
+  }
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  RleFieldWriter writer(buffer, field_size_);
+  readRuns(writer);
+  if (!writer.finish())
+  {
+    return false;
+  }
+  auto const pattern = Utilities::createRlePattern(buffer.data());
+  if (pattern->size() != field_size_ || pattern->points().size() != static_cast<int>(life_units.size()))
+  {
+    return false;
+  }
+  QSet<QPoint> cells;
+  for (auto const& point : pattern->points())
+  {
+    cells.insert(point + field_size_ / 2);
+  }
+  return std::all_of(life_units.begin(), life_units.end(), [&cells](LifeUnit unit)
+  {
+    return cells.contains(QPoint(unit.x(), unit.y()));
+  });
+}
+
+// Runs of equal cells of the published generation, visitor(x, y, length, state),
+// with the rows counted from the top as in pattern files: the pattern row y is the
+// field row field_size_.y() - 1 - y. While the engine field holds it the bytes are
+// read 64 cells at a time skipping the empty ones, otherwise the published units
+// already are in rows and they are read a row at a time from the last one.
+template<typename RunVisitor>
+void LifeProcessorImpl::readRuns(RunVisitor& visitor)
+{
+  int run_x = 0;
+  int run_y = 0;
+  int run_length = 0;
+  uint8_t run_state = 0;
+  auto const add = [&](int x, int y, int length, uint8_t state)
+  {
+    if (run_length > 0 && y == run_y && x == run_x + run_length && state == run_state)
+    {
+      run_length += length;
+      return;
+    }
+    if (run_length > 0)
+    {
+      visitor(run_x, run_y, run_length, run_state);
+    }
+    run_x = x;
+    run_y = y;
+    run_length = length;
+    run_state = state;
+  };
+
+  auto const last_row = field_size_.y() - 1;
+  if (!field_published_ || !computed())
+  {
+    auto const& life_units = snapshot_.lifeUnits();
+    for (auto row_end = life_units.size(); row_end > 0;)
+    {
+      auto const y = life_units[row_end - 1].y();
+      auto row_begin = row_end - 1;
+      while (row_begin > 0 && life_units[row_begin - 1].y() == y)
+      {
+        --row_begin;
+      }
+      for (auto idx = row_begin; idx < row_end; ++idx)
+      {
+        auto const unit = life_units[idx];
+        add(unit.x(), last_row - unit.y(), 1, static_cast<uint8_t>(unit.player() + 1));
+      }
+      row_end = row_begin;
+    }
+  }
+  else
+  {
+    Q_ASSERT(lookahead_.empty());
+    Q_ASSERT(field_size_.x() % (c_words_per_chunk * sizeof(uint64_t)) == 0);
+    auto const* field = data();
+    for (int y = 0; y < field_size_.y(); ++y)
+    {
+      auto const* row = field + (last_row - y) * field_size_.x();
+      for (int x = 0; x < field_size_.x(); x += c_words_per_chunk * sizeof(uint64_t))
+      {
+        uint64_t words[c_words_per_chunk];
+        std::memcpy(words, row + x, sizeof(words));
+        uint64_t any = 0;
+        for (auto const word : words)
+        {
+          any |= word;
+        }
+        if (any == 0)
+        {
+          continue;
+        }
+        for (size_t idx = 0; idx < c_words_per_chunk; ++idx)
+        {
+          auto const word = words[idx];
+          auto const word_x = x + static_cast<int>(idx * sizeof(uint64_t));
+          if ((word & ~c_low_bytes) != 0)
+          {
+            for (size_t byte = 0; byte < sizeof(uint64_t); ++byte)
+            {
+              if (auto const state = static_cast<uint8_t>(word >> (byte * 8)))
+              {
+                add(word_x + static_cast<int>(byte), y, 1, state);
+              }
+            }
+            continue;
+          }
+          // Cells of one player only, gathered into a byte of bits.
+          for (auto bits = static_cast<uint32_t>((word * c_gather_low_bits) >> 56); bits != 0;)
+          {
+            auto const start = static_cast<int>(qCountTrailingZeroBits(bits));
+            auto const length = static_cast<int>(qCountTrailingZeroBits(~(bits >> start)));
+            add(word_x + start, y, length, 1);
+            bits &= ~(((1u << length) - 1) << start);
+          }
+        }
+      }
+    }
+  }
+  if (run_length > 0)
+  {
+    visitor(run_x, run_y, run_length, run_state);
   }
 }
 
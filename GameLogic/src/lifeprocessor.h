@@ -1,7 +1,14 @@
 #ifndef LIFEPROCESSOR_H
 #define LIFEPROCESSOR_H
 
+#include <deque>
+#include <functional>
+
+#include <QMutex>
+
 #include "../gamemodel.h"
+#include "../../Utilities/mpscring.h"
+#include "lifesnapshot.h"
 
 namespace Logic {
 
@@ -10,32 +17,115 @@ class LifeProcessorImpl : public LifeProcessor
 public:
   explicit LifeProcessorImpl(QPoint field_size)
     : field_size_(field_size)
+    , snapshot_(field_size)
   {}
 
 public: // LifeProcessor
   LifeUnits const& lifeUnits() const final
   {
-    return life_units_;
+    return snapshot_.lifeUnits();
+  }
+  LifeSnapshot const& snapshot() final
+  {
+    return snapshot_;
   }
 
   void addUnit(LifeUnit unit) final;
-  void processLife(bool compute) final;
+  void stamp(Pattern const& pattern, PatternVariant variant, QPoint offset, PlayerId player) final;
+  bool post(PatternCommand command) final
+  {
+    return commands_.push(std::move(command));
+  }
+  // The precomputed generations are rewound by a placement.
+  StepId generation() const final
+  {
+    return field_generation_ - static_cast<StepId>(lookahead_.size());
+  }
+  bool processLife(bool compute) final;
+  bool skipLife() final;
+  void setLookahead(SizeT generations) final
+  {
+    Q_ASSERT(generations >= 0);
+    lookahead_limit_ = static_cast<size_t>(generations);
+  }
+  bool precompute() final;
+  bool lookaheadFull() const final
+  {
+    return lookahead_.size() >= lookahead_limit_;
+  }
+  void setComputedHandler(std::function<void()> handler) final
+  {
+    QMutexLocker lock(&computed_handler_mutex_);
+    computed_handler_ = std::move(handler);
+  }
+  bool exportField(QIODevice& device, FieldFormat format) final;
 
 public:
+  // Replaces the field by a random soup of the first player, used by the calibration.
+  void fillRandom(qreal density, uint64_t seed);
   SizeT fieldSize() const
   {
     return field_size_.x() * field_size_.y();
   }
+  QPoint fieldCells() const
+  {
+    return field_size_;
+  }
 
 protected:
   virtual void processLife() = 0;
   virtual uint8_t* data() = 0;
+  // Rows of data() written by the processor, taken modulo the field height.
+  virtual void fieldChanged(int first_row, int rows)
+  {
+    Q_UNUSED(first_row);
+    Q_UNUSED(rows);
+  }
+  // Brings data() up to the engine field, which is only guaranteed after
+  // generations computed with fieldWanted().
+  virtual void syncField() {}
+  bool fieldWanted() const
+  {
+    return field_wanted_;
+  }
+  // Called by the engine on its completion thread once data() holds the new
+  // generation, before computed() turns true.
+  void generationComputed();
+  // Called by the engine on its completion thread after computed() turned true.
+  void notifyComputed();
 
 private:
   void prepareLifeUnits();
+  void takeFieldUnits(LifeUnits& life_units);
+  void startComputation(bool field_wanted);
+  void applyCommands();
+  void apply(PatternCommand const& command);
+  void beginFieldChange();
+  void endFieldChange(int first_row, int rows);
+  void extractLifeUnits(LifeUnits& life_units);
+  void publish();
+  void rewind();
+  template<typename RunVisitor>
+  void readRuns(RunVisitor& visitor);
+  bool rleRoundTrips();
 
   QPoint const field_size_;
-  LifeUnits life_units_;
+  LifeSnapshotImpl snapshot_;
+  // Generations following the published one, the engine field holds the next after them.
+  std::deque<LifeUnits> lookahead_;
+  size_t lookahead_limit_ = 0;
+  // The engine field is the published generation.
+  bool field_published_ = false;
+  // The host field is read by the processor after the current computation.
+  bool field_wanted_ = true;
+  // Units of the engine field, extracted on the engine completion.
+  LifeUnits field_units_;
+  bool field_extracted_ = false;
+  StepId field_generation_ = 0;
+  Utilities::MpscRing<PatternCommand, 1024> commands_;
+  std::vector<PatternCommand> pending_commands_;
+  QMutex computed_handler_mutex_;
+  std::function<void()> computed_handler_;
 };
 
 LifeProcessorPtr createGPULifeProcessor(QPoint field_size);
@@ -0,0 +1,63 @@
+#ifndef LIFESNAPSHOT_H
+#define LIFESNAPSHOT_H
+
+#include "../gamemodel.h"
+#include "densitypyramid.h"
+#include "lifeunitsindex.h"
+
+namespace Logic {
+
+// The published generation. The processor fills the units in place and derives
+// the rest from them, the view reads it on the same thread between two steps.
+class LifeSnapshotImpl final : public LifeSnapshot
+{
+public:
+  explicit LifeSnapshotImpl(QPoint field_size)
+    : life_units_index_(field_size)
+    , density_pyramid_(field_size)
+  {}
+
+public: // LifeSnapshot
+  uint64_t sequence() const override
+  {
+    return sequence_;
+  }
+  LifeUnits const& lifeUnits() const override
+  {
+    return life_units_;
+  }
+  LifeUnits lifeUnitsIn(QRect region) const override
+  {
+    return life_units_index_.unitsIn(region);
+  }
+  DensityLevels const& densityLevels() const override
+  {
+    return density_pyramid_.levels();
+  }
+  QVector<QRect> const& changedRegions() const override
+  {
+    return life_units_index_.changedRegions();
+  }
+
+public:
+  LifeUnits& mutableLifeUnits()
+  {
+    return life_units_;
+  }
+  void rebuild()
+  {
+    ++sequence_;
+    life_units_index_.rebuild(life_units_);
+    density_pyramid_.rebuild(life_units_);
+  }
+
+private:
+  uint64_t sequence_ = 0;
+  LifeUnits life_units_;
+  LifeUnitsIndex life_units_index_;
+  DensityPyramid density_pyramid_;
+};
+
+} // Logic
+
+#endif // LIFESNAPSHOT_H
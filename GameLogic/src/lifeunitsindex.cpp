@@ -0,0 +1,111 @@
+#include <algorithm>
+
+#include "lifeunitsindex.h"
+
+namespace Logic {
+
+namespace {
+
+constexpr int const c_max_tile_size = 64;
+
+} // namespace
+
+LifeUnitsIndex::LifeUnitsIndex(QPoint field_size)
+  : field_size_(field_size)
+  , tile_size_(std::min({ c_max_tile_size, field_size.x(), field_size.y() }))
+  , tiles_(field_size.x() / tile_size_, field_size.y() / tile_size_)
+  , offsets_(static_cast<size_t>(tiles_.x() * tiles_.y() + 1), 0)
+  , previous_offsets_(offsets_)
+{
+  Q_ASSERT(field_size_.x() % tile_size_ == 0);
+  Q_ASSERT(field_size_.y() % tile_size_ == 0);
+}
+
+void LifeUnitsIndex::rebuild(LifeUnits const& life_units)
+{
+  offsets_.swap(previous_offsets_);
+  units_.swap(previous_units_);
+  std::fill(offsets_.begin(), offsets_.end(), 0);
+  for (auto const unit : life_units)
+  {
+    ++offsets_[tileAt(unit.x() / tile_size_, unit.y() / tile_size_) + 1];
+  }
+  for (size_t tile = 1; tile < offsets_.size(); ++tile)
+  {
+    offsets_[tile] += offsets_[tile - 1];
+  }
+
+  units_.resize(life_units.size(), LifeUnit(0, 0));
+  auto positions = offsets_;
+  for (auto const unit : life_units)
+  {
+    units_[positions[tileAt(unit.x() / tile_size_, unit.y() / tile_size_)]++] = unit;
+  }
+  collectChangedTiles();
+}
+
+LifeUnits LifeUnitsIndex::unitsIn(QRect region) const
+{
+  LifeUnits result;
+  forEachIn(region, [&result](LifeUnit unit)
+  {
+    result.push_back(unit);
+  });
+  return result;
+}
+
+// Units keep the extraction order inside a tile, so a tile is unchanged exactly when
+// its range equals the previous one. Neighbouring changed tiles of a row are merged.
+void LifeUnitsIndex::collectChangedTiles()
+{
+  auto const& offsets = previous_offsets_;
+  auto const& units = previous_units_;
+  changed_regions_.clear();
+  for (int tile_y = 0; tile_y < tiles_.y(); ++tile_y)
+  {
+    auto row_begin = changed_regions_.size();
+    for (int tile_x = 0; tile_x < tiles_.x(); ++tile_x)
+    {
+      auto const tile = tileAt(tile_x, tile_y);
+      auto const count = offsets_[tile + 1] - offsets_[tile];
+      auto const unchanged = count == offsets[tile + 1] - offsets[tile]
+          && std::equal(units_.begin() + offsets_[tile], units_.begin() + offsets_[tile + 1],
+                        units.begin() + offsets[tile]);
+      if (unchanged)
+      {
+        row_begin = changed_regions_.size();
+        continue;
+      }
+      if (changed_regions_.size() > row_begin)
+      {
+        auto& region = changed_regions_.back();
+        region.setWidth(region.width() + tile_size_);
+      }
+      else
+      {
+        changed_regions_.push_back(QRect(tile_x * tile_size_, tile_y * tile_size_, tile_size_, tile_size_));
+      }
+    }
+  }
+}
+
+// Maps [begin, begin + length) onto the torus as at most two half-open ranges.
+LifeUnitsIndex::Ranges LifeUnitsIndex::split(int begin, int length, int dimension) const
+{
+  Ranges result;
+  length = std::min(length, dimension);
+  if (length <= 0)
+  {
+    return result;
+  }
+  begin = ((begin % dimension) + dimension) % dimension;
+  auto const end = begin + length;
+  result.push_back(qMakePair(begin, std::min(end, dimension)));
+  if (end > dimension)
+  {
+    result.push_back(qMakePair(0, end - dimension));
+  }
+  return result;
+}
+
+} // Logic
@@ -0,0 +1,81 @@
+#ifndef LIFEUNITSINDEX_H
+#define LIFEUNITSINDEX_H
+
+#include <QRect>
+
+#include "../gamemodel.h"
+
+namespace Logic {
+
+// Live units bucketed by square tiles, so a region query touches only
+// the tiles it overlaps. Regions are given on the torus and may wrap.
+class LifeUnitsIndex
+{
+public:
+  using Regions = QVector<QRect>;
+
+  explicit LifeUnitsIndex(QPoint field_size);
+
+  // Changed regions are collected against the tiles of the previous rebuild,
+  // which are kept aside.
+  void rebuild(LifeUnits const& life_units);
+  LifeUnits unitsIn(QRect region) const;
+  Regions const& changedRegions() const
+  {
+    return changed_regions_;
+  }
+
+  template<typename Visitor>
+  void forEachIn(QRect region, Visitor&& visitor) const;
+
+private:
+  using Range = QPair<int, int>;
+  using Ranges = QVector<Range>;
+
+  Ranges split(int begin, int length, int dimension) const;
+  void collectChangedTiles();
+  int tileAt(int tile_x, int tile_y) const
+  {
+    return tile_x + tile_y * tiles_.x();
+  }
+
+  QPoint const field_size_;
+  int const tile_size_ = 0;
+  QPoint const tiles_;
+  std::vector<uint32_t> offsets_;
+  LifeUnits units_;
+  std::vector<uint32_t> previous_offsets_;
+  LifeUnits previous_units_;
+  Regions changed_regions_;
+};
+
+template<typename Visitor>
+void LifeUnitsIndex::forEachIn(QRect region, Visitor&& visitor) const
+{
+  for (auto const& rows : split(region.y(), region.height(), field_size_.y()))
+  {
+    for (auto const& columns : split(region.x(), region.width(), field_size_.x()))
+    {
+      for (int tile_y = rows.first / tile_size_; tile_y <= (rows.second - 1) / tile_size_; ++tile_y)
+      {
+        for (int tile_x = columns.first / tile_size_; tile_x <= (columns.second - 1) / tile_size_; ++tile_x)
+        {
+          auto const tile = tileAt(tile_x, tile_y);
+          for (auto idx = offsets_[tile]; idx < offsets_[tile + 1]; ++idx)
+          {
+            auto const unit = units_[idx];
+            if (unit.x() >= columns.first && unit.x() < columns.second
+                && unit.y() >= rows.first && unit.y() < rows.second)
+            {
+              visitor(unit);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+} // Logic
+
+#endif // LIFEUNITSINDEX_H
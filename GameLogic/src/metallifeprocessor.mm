@@ -50,6 +50,8 @@ static NSString* const kernel_src =
 - (void*) content;
 - (CFTimeInterval) computationDuration;
 - (void) processLife;
+- (void) setComputedHandler: (void (^)(void))handler;
+- (void) setIdleHandler: (void (^)(void))handler;
 
 @end
 
@@ -65,6 +67,8 @@ static NSString* const kernel_src =
 
   BOOL computed_;
   CFTimeInterval computation_duration_;
+  void (^computed_handler_)(void);
+  void (^idle_handler_)(void);
 }
 
 - (NSUInteger) fieldSize
@@ -87,6 +91,16 @@ static NSString* const kernel_src =
   return computation_duration_;
 }
 
+- (void) setComputedHandler: (void (^)(void))handler
+{
+  computed_handler_ = [handler copy];
+}
+
+- (void) setIdleHandler: (void (^)(void))handler
+{
+  idle_handler_ = [handler copy];
+}
+
 - (id) initWithWidth: (NSUInteger)width Height:(NSUInteger)height
 {
   self = [super init];
@@ -157,19 +171,28 @@ static NSString* const kernel_src =
   [command_buffer addCompletedHandler: ^(id<MTLCommandBuffer> cb)
   {
     assert([[cb error] code] == 0);
-    [self handleComputeCompletion];
     computation_duration_ = -[start timeIntervalSinceNow];
+    [self handleComputeCompletion];
   }];
   [command_buffer commit];
 }
 
+// The handler reads the new input, so the buffers are swapped first.
 - (void) handleComputeCompletion
 {
-  computed_ = YES;
-
   id<MTLBuffer> tmp = input_;
   input_ = output_;
   output_ = tmp;
+
+  if (computed_handler_)
+  {
+    computed_handler_();
+  }
+  computed_ = YES;
+  if (idle_handler_)
+  {
+    idle_handler_();
+  }
 }
 
 @end
@@ -187,7 +210,10 @@ public:
     , self_([[MetalLifeProcessor alloc]
         initWithWidth: static_cast<NSUInteger>(field_size.x())
                 Height: static_cast<NSUInteger>(field_size.y())])
-  {}
+  {
+    [self_ setComputedHandler: ^{ generationComputed(); }];
+    [self_ setIdleHandler: ^{ notifyComputed(); }];
+  }
   catch(NSException* e)
   {
     auto const* msg = [[e reason] cStringUsingEncoding: NSUTF8StringEncoding];
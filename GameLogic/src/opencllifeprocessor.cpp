@@ -4,221 +4,414 @@
 #include <CL/cl.hpp>
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <numeric>
 #include <vector>
 #include <string>
-#include <set>
 
 #include <QDebug>
 
-#include "gpulifeprocessor.h"
+#include "lifeprocessor.h"
 
 namespace Logic {
 
 namespace {
 
-std::string const kernel_src =
-    "ushort2 pos(uint id) "
-    "{ "
-    "  return (ushort2)(id % WIDTH, id / HEIGHT); "
-    "}\n"
-
-    "uint idx(ushort2 pos) "
-    "{ "
-    "  return pos.x + pos.y * HEIGHT; "
-    "}\n"
+using Clock = std::chrono::steady_clock;
 
-    "ushort2 loopPos(short x, short y) "
-    "{ "
-    "  return (ushort2)((x + WIDTH) % WIDTH, (y + HEIGHT) % HEIGHT); "
-    "}\n"
+constexpr uint64_t const c_rebalance_period = 16;
+constexpr qreal const c_rebalance_tolerance = 0.02;
+constexpr qreal const c_throughput_smoothing = 0.25;
 
+// Every device owns a horizontal slab of the torus. Its buffers hold the slab rows
+// plus one halo row above and below, so the kernel never wraps vertically.
+std::string const kernel_src =
     "kernel void lifeStep(global const uchar* input, "
     "                     global       uchar* output) "
     "{ "
-    "  ushort2 gid = pos(get_global_id(0)); "
-    "  uint nw = idx(loopPos(gid.x - 1, gid.y + 1)); "
-    "  uint n  = idx(loopPos(gid.x,     gid.y + 1)); "
-    "  uint ne = idx(loopPos(gid.x + 1, gid.y + 1)); "
-    "  uint e  = idx(loopPos(gid.x + 1, gid.y)); "
-    "  uint se = idx(loopPos(gid.x + 1, gid.y - 1)); "
-    "  uint s  = idx(loopPos(gid.x    , gid.y - 1)); "
-    "  uint sw = idx(loopPos(gid.x - 1, gid.y - 1)); "
-    "  uint w  = idx(loopPos(gid.x - 1, gid.y)); "
+    "  uint x = get_global_id(0); "
+    "  uint y = get_global_id(1) + 1; "
+    "  uint w = (x + WIDTH - 1) % WIDTH; "
+    "  uint e = (x + 1) % WIDTH; "
+
+    "  global const uchar* n = input + (y - 1) * WIDTH; "
+    "  global const uchar* c = input + y * WIDTH; "
+    "  global const uchar* s = input + (y + 1) * WIDTH; "
 
     "  uchar neighbours = "
-    "    input[nw] + input[n] + input[ne] + input[e] + input[se] + input[s] + input[sw] + input[w]; "
+    "    (n[w] != 0) + (n[x] != 0) + (n[e] != 0) + "
+    "    (c[w] != 0) +               (c[e] != 0) + "
+    "    (s[w] != 0) + (s[x] != 0) + (s[e] != 0); "
 
-    "  uchar self = input[idx(gid)]; "
+    "  uchar self = c[x]; "
 
-    "  output[idx(gid)] = (self == 0) ? (neighbours == 3) : (neighbours == 2 || neighbours == 3); "
+    "  output[y * WIDTH + x] = (self == 0) ? (neighbours == 3) : (neighbours == 2 || neighbours == 3); "
     "}\n";
 
-class OpenCLLifeProcessor
+class DeviceSlab
 {
 public:
-  explicit OpenCLLifeProcessor(QPoint field_size)
-    : field_size_(field_size)
+  using Completion = std::function<void()>;
+
+  explicit DeviceSlab(cl::Device const& device, QPoint field_size, Completion completion)
+    : completion_(std::move(completion))
+    , device_(device)
+    , context_(device)
+    , command_queue_(context_, device)
+    , width_(static_cast<size_t>(field_size.x()))
+    , height_(static_cast<size_t>(field_size.y()))
   {
-    cl_int error = 0;
-    cl::Platform platform = cl::Platform::getDefault(&error);
-    if (error != 0)
-    {
-      throw std::runtime_error("OpenCL is not supported on this device");
-    }
-    qDebug() << platform.getInfo<CL_PLATFORM_NAME>().c_str();
-
-    std::vector<cl::Device> devices;
-    platform.getDevices(CL_DEVICE_TYPE_GPU, &devices);
-    Q_ASSERT(!devices.empty());
-
-    for (auto const& device : devices)
-    {
-      qDebug() << device.getInfo<CL_DEVICE_NAME>().c_str();
-    }
-    cl::Device gpu_device = devices.front();
-    cl::Context context({ gpu_device });
-
     cl::Program::Sources src;
     src.push_back({ kernel_src.data(), kernel_src.size() });
 
-    cl::Program program(context, src);
-    std::string options = "-D WIDTH=" + std::to_string(field_size_.x())
-        + " -D HEIGHT=" + std::to_string(field_size_.y());
-    qDebug() << options.c_str();
-    cl_int result = program.build({ gpu_device }, options.c_str());
-    if (result != CL_SUCCESS)
+    cl::Program program(context_, src);
+    std::string const options = "-D WIDTH=" + std::to_string(field_size.x());
+    if (program.build({ device_ }, options.c_str()) != CL_SUCCESS)
     {
-      qDebug() << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(gpu_device).c_str();
+      qDebug() << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device_).c_str();
+      throw std::runtime_error("Impossible to build OpenCL program for " + name());
     }
-
-    in_pinned_buffer_ = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, fieldSize());
-    out_pinned_buffer_ = cl::Buffer(context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, fieldSize());
-
-    in_buffer_ = cl::Buffer(context, CL_MEM_READ_ONLY, fieldSize());
-    out_buffer_ = cl::Buffer(context, CL_MEM_WRITE_ONLY, fieldSize());
-
-    command_queue_ = cl::CommandQueue(context, gpu_device);
-
-    input_ = static_cast<uint8_t*>(
-          command_queue_.enqueueMapBuffer(in_pinned_buffer_, CL_TRUE, CL_MAP_WRITE, 0, fieldSize()));
-    output_ = static_cast<uint8_t*>(
-          command_queue_.enqueueMapBuffer(out_pinned_buffer_, CL_TRUE, CL_MAP_READ, 0, fieldSize()));
-
     kernel_ = cl::Kernel(program, "lifeStep");
-    kernel_.setArg(0, in_buffer_);
-    kernel_.setArg(1, out_buffer_);
-    Q_ASSERT(error == 0);
+
+    // Until the first generations are measured the share is guessed from the hardware.
+    auto const compute_units = device_.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+    auto const clock_frequency = device_.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>();
+    throughput_ = std::max(1.0, static_cast<qreal>(compute_units) * clock_frequency);
   }
 
-  uint8_t unitAt(size_t position) const
+  std::string name() const
   {
-    Q_ASSERT(position < fieldSize());
-    return input_[position];
+    return device_.getInfo<CL_DEVICE_NAME>();
+  }
+  size_t rows() const
+  {
+    return rows_;
+  }
+  qreal throughput() const
+  {
+    return throughput_;
   }
 
-  void processLife()
+  void assignRows(size_t row_begin, size_t rows)
   {
-    cl_int error = 0;
-    if (!completion_.empty())
+    Q_ASSERT(rows > 0);
+    Q_ASSERT(row_begin + rows <= height_);
+    row_begin_ = row_begin;
+    rows_ = rows;
+    uploaded_ = false;
+
+    auto const buffer_size = (rows_ + 2) * width_;
+    if (buffer_size > capacity_)
     {
-      error = cl::Event::waitForEvents(completion_);
-      Q_ASSERT(error == 0);
-      completion_.clear();
-      handleComputeCompletion();
+      capacity_ = buffer_size;
+      input_ = cl::Buffer(context_, CL_MEM_READ_WRITE, capacity_);
+      output_ = cl::Buffer(context_, CL_MEM_READ_WRITE, capacity_);
     }
+  }
 
-    error = command_queue_.enqueueWriteBuffer(in_buffer_, CL_TRUE, 0, fieldSize(), input_);
-    Q_ASSERT(error == 0);
-    completion_.emplace_back();
-    auto& event = completion_.back();
-
-    error = command_queue_
-        .enqueueNDRangeKernel(kernel_, cl::NullRange, cl::NDRange(fieldSize()), cl::NullRange, nullptr, &event);
-    Q_ASSERT(error == 0);
+  void invalidate()
+  {
+    uploaded_ = false;
+  }
+  // Changed rows are taken modulo the field height.
+  bool intersects(size_t first_row, size_t rows) const
+  {
+    if (rows >= height_)
+    {
+      return true;
+    }
+    auto const begin = first_row % height_;
+    auto const end = begin + rows;
+    auto const overlaps = [this](size_t range_begin, size_t range_end)
+    {
+      return range_begin < row_begin_ + rows_ && row_begin_ < range_end;
+    };
+    return end <= height_ ? overlaps(begin, end) : (overlaps(begin, height_) || overlaps(0, end - height_));
   }
 
-  void addUnit(size_t position)
+  // The slab stays resident on the device between generations,
+  // only the two halo rows computed by the neighbours are sent. Unless the
+  // host needs the whole field, only the slab edges the neighbours use as
+  // their halos are read back.
+  void enqueue(uint8_t const* input, uint8_t* output, bool read_all)
   {
-    if (completion_.empty())
+    auto const top_halo = (row_begin_ + height_ - 1) % height_;
+    auto const bottom_halo = (row_begin_ + rows_) % height_;
+
+    cl_int error = CL_SUCCESS;
+    if (!uploaded_)
+    {
+      error |= command_queue_.enqueueWriteBuffer(
+            input_, CL_FALSE, width_, rows_ * width_, input + row_begin_ * width_);
+      uploaded_ = true;
+    }
+    error |= command_queue_.enqueueWriteBuffer(
+          input_, CL_FALSE, 0, width_, input + top_halo * width_);
+    error |= command_queue_.enqueueWriteBuffer(
+          input_, CL_FALSE, (rows_ + 1) * width_, width_, input + bottom_halo * width_);
+
+    error |= kernel_.setArg(0, input_);
+    error |= kernel_.setArg(1, output_);
+    error |= command_queue_.enqueueNDRangeKernel(
+          kernel_, cl::NullRange, cl::NDRange(width_, rows_), cl::NullRange);
+
+    cl::Event read_event;
+    if (read_all || rows_ == 1)
     {
-      Q_ASSERT(position < static_cast<size_t>(field_size_.x() * field_size_.y()));
-      input_[position] = 1;
+      error |= command_queue_.enqueueReadBuffer(
+            output_, CL_FALSE, width_, rows_ * width_, output + row_begin_ * width_, nullptr, &read_event);
     }
     else
     {
-      position_cache_.insert(position);
+      error |= command_queue_.enqueueReadBuffer(
+            output_, CL_FALSE, width_, width_, output + row_begin_ * width_);
+      error |= command_queue_.enqueueReadBuffer(
+            output_, CL_FALSE, rows_ * width_, width_, output + (row_begin_ + rows_ - 1) * width_,
+            nullptr, &read_event);
+    }
+    host_stale_ = !read_all && rows_ > 2;
+    start_ = Clock::now();
+    error |= read_event.setCallback(CL_COMPLETE, &DeviceSlab::onComputed, this);
+    error |= command_queue_.flush();
+    Q_ASSERT(error == CL_SUCCESS);
+
+    std::swap(input_, output_);
+  }
+
+  void finish()
+  {
+    command_queue_.finish();
+  }
+
+  // Reads the rows skipped by the last generations into the host field.
+  void sync(uint8_t* input)
+  {
+    if (!host_stale_)
+    {
+      return;
     }
+    auto const error = command_queue_.enqueueReadBuffer(
+          input_, CL_TRUE, width_, rows_ * width_, input + row_begin_ * width_);
+    Q_ASSERT(error == CL_SUCCESS);
+    Q_UNUSED(error);
+    host_stale_ = false;
   }
 
 private:
-  size_t fieldSize() const
+  static void CL_CALLBACK onComputed(cl_event, cl_int status, void* user_data)
   {
-    return field_size_.x() * field_size_.y();
+    Q_ASSERT(status == CL_COMPLETE);
+    static_cast<DeviceSlab*>(user_data)->handleComputeCompletion();
   }
 
   void handleComputeCompletion()
   {
-    auto error = command_queue_.enqueueReadBuffer(out_buffer_, CL_TRUE, 0, fieldSize(), output_);
-    Q_ASSERT(error == 0);
-    std::memset(input_, 0, fieldSize());
-    std::swap(input_, output_);
-
-    for (auto const pos : position_cache_)
+    auto const seconds = std::chrono::duration<qreal>(Clock::now() - start_).count();
+    if (seconds > 0.0)
     {
-      addUnit(pos);
+      auto const measured = rows_ / seconds;
+      throughput_ = measured_ ? throughput_ + c_throughput_smoothing * (measured - throughput_) : measured;
+      measured_ = true;
     }
-    position_cache_.clear();
+    completion_();
   }
 
-  QPoint const field_size_;
-  uint8_t* input_ = nullptr;
-  uint8_t* output_ = nullptr;
-
-  cl::Buffer in_pinned_buffer_;
-  cl::Buffer out_pinned_buffer_;
-  cl::Buffer in_buffer_;
-  cl::Buffer out_buffer_;
+  Completion const completion_;
+  cl::Device device_;
+  cl::Context context_;
   cl::CommandQueue command_queue_;
   cl::Kernel kernel_;
-  std::vector<cl::Event> completion_;
-
-  std::set<size_t> position_cache_;
+  cl::Buffer input_;
+  cl::Buffer output_;
+
+  size_t width_ = 0;
+  size_t height_ = 0;
+  size_t capacity_ = 0;
+  size_t row_begin_ = 0;
+  size_t rows_ = 0;
+  bool uploaded_ = false;
+  bool host_stale_ = false;
+  bool measured_ = false;
+  qreal throughput_ = 0.0;
+  Clock::time_point start_;
 };
 
-} // namespace
+class OpenCLLifeProcessor final : public LifeProcessorImpl
+{
+public:
+  explicit OpenCLLifeProcessor(QPoint field_size)
+    : LifeProcessorImpl(field_size)
+    , input_(static_cast<size_t>(fieldSize()))
+    , output_(static_cast<size_t>(fieldSize()))
+  {
+    std::vector<cl::Platform> platforms;
+    if (cl::Platform::get(&platforms) != CL_SUCCESS || platforms.empty())
+    {
+      throw std::runtime_error("OpenCL is not supported on this device");
+    }
 
-GPULifeProcessor::GPULifeProcessor(QPoint field_size)
-  : self_(new OpenCLLifeProcessor(field_size))
-  , field_size_(field_size)
-{}
+    auto const max_slabs = static_cast<size_t>(field_size.y());
+    for (auto const& platform : platforms)
+    {
+      qDebug() << platform.getInfo<CL_PLATFORM_NAME>().c_str();
+
+      std::vector<cl::Device> devices;
+      platform.getDevices(CL_DEVICE_TYPE_ALL, &devices);
+      for (auto const& device : devices)
+      {
+        if (slabs_.size() < max_slabs)
+        {
+          slabs_.emplace_back(device, field_size, [this] { handleComputeCompletion(); });
+          qDebug() << slabs_.back().name().c_str();
+        }
+      }
+    }
+    if (slabs_.empty())
+    {
+      throw std::runtime_error("There are no OpenCL devices");
+    }
+    rebalance();
+  }
+  ~OpenCLLifeProcessor() override
+  {
+    for (auto& slab : slabs_)
+    {
+      slab.finish();
+    }
+    while (!computed());
+  }
 
-GPULifeProcessor::~GPULifeProcessor()
-{
-  delete static_cast<OpenCLLifeProcessor*>(self_);
-}
+public: // LifeProcessor
+  bool computed() const override
+  {
+    return computed_;
+  }
+  int computationDuration() const override
+  {
+    return last_computation_duration_;
+  }
 
-void GPULifeProcessor::addUnit(LifeUnit unit)
-{
-  static_cast<OpenCLLifeProcessor*>(self_)->addUnit(unit.x() + unit.y() * field_size_.y());
-}
+protected: // LifeProcessorImpl
+  void processLife() override
+  {
+    Q_ASSERT(computed());
+    if (++generation_ % c_rebalance_period == 0)
+    {
+      rebalance();
+    }
+    computed_ = false;
+    remaining_slabs_ = static_cast<int>(slabs_.size());
+    computation_start_ = Clock::now();
+    for (auto& slab : slabs_)
+    {
+      slab.enqueue(input_.data(), output_.data(), fieldWanted());
+    }
+  }
+  uint8_t* data() override
+  {
+    return input_.data();
+  }
+  // Only the slabs holding changed rows upload their rows again.
+  void fieldChanged(int first_row, int rows) override
+  {
+    for (auto& slab : slabs_)
+    {
+      if (slab.intersects(static_cast<size_t>(first_row), static_cast<size_t>(rows)))
+      {
+        slab.invalidate();
+      }
+    }
+  }
+  void syncField() override
+  {
+    for (auto& slab : slabs_)
+    {
+      slab.sync(input_.data());
+    }
+  }
 
-void GPULifeProcessor::processLife()
-{
-  auto* impl = static_cast<OpenCLLifeProcessor*>(self_);
-  life_units_.clear();
+private:
+  void handleComputeCompletion()
+  {
+    if (--remaining_slabs_ > 0)
+    {
+      return;
+    }
+    input_.swap(output_);
+    last_computation_duration_ = static_cast<int>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - computation_start_).count());
+    generationComputed();
+    computed_ = true;
+    notifyComputed();
+  }
 
-  auto const field_size = static_cast<size_t>(field_size_.x() * field_size_.y());
-  for (size_t idx = 0; idx < field_size; ++idx)
+  // Splits the rows proportionally to the measured throughput of every device.
+  // Moving a boundary costs a full upload of every slab, so small drifts are ignored.
+  void rebalance()
   {
-    if (impl->unitAt(idx) != 0)
+    auto const height = static_cast<size_t>(fieldCells().y());
+    auto const total_throughput = std::accumulate(slabs_.begin(), slabs_.end(), 0.0,
+      [](qreal sum, DeviceSlab const& slab)
+    {
+      return sum + slab.throughput();
+    });
+
+    std::vector<size_t> rows(slabs_.size(), 1);
+    auto const shared_rows = height - slabs_.size();
+    auto remaining_rows = shared_rows;
+    for (size_t idx = 0; idx < slabs_.size(); ++idx)
+    {
+      auto const share = std::min(remaining_rows, static_cast<size_t>(
+            shared_rows * slabs_[idx].throughput() / total_throughput));
+      rows[idx] += share;
+      remaining_rows -= share;
+    }
+    rows.back() += remaining_rows;
+
+    auto changed = false;
+    for (size_t idx = 0; idx < slabs_.size(); ++idx)
+    {
+      auto const delta = std::abs(static_cast<qreal>(rows[idx]) - static_cast<qreal>(slabs_[idx].rows()));
+      changed |= slabs_[idx].rows() == 0 || delta > height * c_rebalance_tolerance;
+    }
+    if (!changed)
+    {
+      return;
+    }
+
+    // The new slabs are uploaded from the host field.
+    syncField();
+    size_t row_begin = 0;
+    for (size_t idx = 0; idx < slabs_.size(); ++idx)
     {
-      int x = idx % field_size_.x();
-      int y = idx / field_size_.y();
-      life_units_.insert(LifeUnit(x, y));
+      auto& slab = slabs_[idx];
+      slab.assignRows(row_begin, rows[idx]);
+      qDebug() << slab.name().c_str() << "rows:" << row_begin << "-" << row_begin + rows[idx]
+               << "throughput:" << slab.throughput();
+      row_begin += rows[idx];
     }
+    Q_ASSERT(row_begin == height);
   }
 
-  impl->processLife();
+  std::vector<uint8_t> input_;
+  std::vector<uint8_t> output_;
+  std::vector<DeviceSlab> slabs_;
+  std::atomic<int> remaining_slabs_ { 0 };
+  std::atomic<bool> computed_ { true };
+  uint64_t generation_ = 0;
+  Clock::time_point computation_start_;
+  int last_computation_duration_ = 0;
+};
+
+} // namespace
+
+LifeProcessorPtr createGPULifeProcessor(QPoint field_size)
+{
+  return std::make_unique<OpenCLLifeProcessor>(field_size);
 }
 
 } // Logic
@@ -1,7 +1,15 @@
 #ifndef GAMEMODELPATTERNS_H
 #define GAMEMODELPATTERNS_H
 
+#include <atomic>
+#include <memory>
+
+#include <QCache>
+#include <QFuture>
+#include <QMutex>
+#include <QThreadPool>
 #include <QVector>
+#include <QtConcurrent>
 
 #include "../../Utilities/rleparser.h"
 
@@ -14,10 +22,16 @@ public:
     : all_patterns_(all_patterns)
   {}
 
+  Utilities::PatternsPtr catalog() const
+  {
+    return all_patterns_;
+  }
   Logic::SizeT patternCount() const
   {
     return all_patterns_->patternCount();
   }
+  void preload()
+  {}
   PatternPtr patternAt(Logic::SizeT idx) const
   {
     return all_patterns_->parsePatternAt(idx);
@@ -27,32 +41,109 @@ private:
   Utilities::PatternsPtr const all_patterns_;
 };
 
+// Every built-in pattern is parsed on a background pool as soon as preload() is
+// called, the small ones with their points and the bitmaps of every variant ready,
+// so placing them never builds anything on the GUI thread. A lookup of a parsed
+// pattern is a plain read, one still in flight is waited for and one not started
+// yet is taken from the queue and parsed by the caller. Library patterns are
+// parsed on request and only the recently used ones are kept.
 class AccumulatePatterns
 {
+  constexpr static Score const c_preload_max_cells = 1 << 16;
+  constexpr static int const c_library_cache_patterns = 64;
+
+  struct Entry
+  {
+    std::atomic<bool> ready_ { false };
+    PatternPtr pattern_;
+  };
+
 public:
   explicit AccumulatePatterns(Utilities::PatternsPtr const all_patterns)
     : all_patterns_(all_patterns)
-    , accumulated_patterns_(all_patterns_->patternCount())
+    , preload_count_(all_patterns_->preloadCount())
+    , entries_(new Entry[static_cast<size_t>(preload_count_)])
+    , library_patterns_(c_library_cache_patterns)
   {}
+  ~AccumulatePatterns()
+  {
+    preload_pool_.clear();
+    preload_pool_.waitForDone();
+  }
+
+  void preload()
+  {
+    Q_ASSERT(futures_.isEmpty());
+    futures_.reserve(preload_count_);
+    for (Logic::SizeT idx = 0; idx < preload_count_; ++idx)
+    {
+      futures_.push_back(QtConcurrent::run(&preload_pool_, [this, idx]
+      {
+        auto& entry = entries_[static_cast<size_t>(idx)];
+        entry.pattern_ = all_patterns_->parsePatternAt(idx);
+        if (entry.pattern_->scores() <= c_preload_max_cells)
+        {
+          entry.pattern_->points();
+          for (PatternVariant variant = 0; variant < c_pattern_variants; ++variant)
+          {
+            entry.pattern_->bitmap(variant);
+          }
+        }
+        entry.ready_.store(true, std::memory_order_release);
+      }));
+    }
+  }
 
+  Utilities::PatternsPtr catalog() const
+  {
+    return all_patterns_;
+  }
   Logic::SizeT patternCount() const
   {
     return all_patterns_->patternCount();
   }
   PatternPtr patternAt(Logic::SizeT idx) const
   {
-    auto pattern_ptr = accumulated_patterns_.at(idx);
-    if (pattern_ptr == nullptr)
+    Q_ASSERT(idx >= 0 && idx < patternCount());
+    Q_ASSERT(futures_.size() == preload_count_);
+    if (idx >= preload_count_)
+    {
+      return libraryPatternAt(idx);
+    }
+    auto const& entry = entries_[static_cast<size_t>(idx)];
+    if (!entry.ready_.load(std::memory_order_acquire))
     {
-      pattern_ptr = all_patterns_->parsePatternAt(idx);
-      accumulated_patterns_[idx] = pattern_ptr;
+      auto future = futures_[idx];
+      future.waitForFinished();
     }
-    return pattern_ptr;
+    return entry.pattern_;
   }
 
 private:
+  // Parsed outside of the lock, two requests of the same pattern may parse it twice.
+  PatternPtr libraryPatternAt(Logic::SizeT idx) const
+  {
+    {
+      QMutexLocker lock(&library_mutex_);
+      if (auto const cached = library_patterns_.object(idx))
+      {
+        return *cached;
+      }
+    }
+    auto pattern = all_patterns_->parsePatternAt(idx);
+    QMutexLocker lock(&library_mutex_);
+    library_patterns_.insert(idx, new PatternPtr(pattern));
+    return pattern;
+  }
+
   Utilities::PatternsPtr const all_patterns_;
-  QVector<PatternPtr> mutable accumulated_patterns_;
+  Logic::SizeT const preload_count_;
+  std::unique_ptr<Entry[]> const entries_;
+  QVector<QFuture<void>> futures_;
+  QThreadPool preload_pool_;
+
+  mutable QMutex library_mutex_;
+  mutable QCache<Logic::SizeT, PatternPtr> library_patterns_;
 };
 
 } // Logic
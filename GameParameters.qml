@@ -58,6 +58,19 @@ Column {
       params.gameSpeed = Number(currentText)
     }
   }
+  ComboBox {
+    id: stepPolicy
+    enabled: !isMultiplayer
+    visible: !isMultiplayer
+    clip: true
+    currentIndex: 0
+    // Logic::StepPolicy order.
+    model: [qsTr("Catch up"), qsTr("Skip frames"), qsTr("Degrade")]
+
+    onCurrentIndexChanged: {
+      params.stepPolicy = currentIndex
+    }
+  }
   ComboBox {
     id: initialScores
     clip: true
@@ -1,10 +1,16 @@
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #include <QPainter>
+#include <QQmlEngine>
 #include <QQuickWindow>
+#include <QSGImageNode>
+#include <QSGOpacityNode>
 
 #include "../Utilities/qtutilities.h"
 #include "gameview.h"
+#include "thumbnailprovider.h"
 
 namespace View {
 
@@ -13,9 +19,13 @@ namespace {
 constexpr auto const c_pattern_selection_color = Qt::GlobalColor::yellow;
 constexpr auto const c_pixels_per_cell = QPointF(10.0, 10.0);
 constexpr auto const c_life_pixels_ratio = 0.3;
-constexpr auto const c_max_cells_in_screen = 1024;
 constexpr auto const c_min_cells_in_screen = 8;
 constexpr auto const c_scale_to_hide_grid = 0.2;
+constexpr auto const c_min_sprite_pixels = 6.0;
+constexpr auto const c_minimap_pixels = 128.0;
+constexpr auto const c_minimap_margin = 8.0;
+constexpr auto const c_max_changed_regions = 1024;
+constexpr auto const c_tile_texels = 256;
 
 template<typename T>
 qreal normalizeValue(T value, T min, T max)
@@ -41,8 +51,204 @@ QColor playerColor(Logic::PlayerId player)
   }
 }
 
+// Blends the dominant player colour over the background, the square root keeps
+// sparse blocks visible.
+QRgb densityColor(QColor const& background, Logic::DensityLevel const& level, size_t block)
+{
+  auto const population = level.population_[block];
+  if (population == 0)
+  {
+    return background.rgb();
+  }
+  auto const area = static_cast<qreal>(level.block_size_ * level.block_size_);
+  auto const density = std::sqrt(std::min(1.0, population / area));
+  auto const color = playerColor(level.dominant_players_[block]);
+  auto const blend = [density](int from, int to)
+  {
+    return static_cast<int>(from + (to - from) * density);
+  };
+  return qRgb(blend(background.red(), color.red()),
+              blend(background.green(), color.green()),
+              blend(background.blue(), color.blue()));
+}
+
+using Span = QPair<int, int>;
+
+// Places [begin, begin + length) of a wrapped axis into the covered range [0, covered)
+// that starts at origin, the result has at most two pieces.
+QVector<Span> coveredSpans(int begin, int length, int origin, int covered, int dimension)
+{
+  QVector<Span> result;
+  auto const offset = ((begin - origin) % dimension + dimension) % dimension;
+  for (auto const start : { offset, offset - dimension })
+  {
+    auto const first = std::max(start, 0);
+    auto const last = std::min(start + length, covered);
+    if (first < last)
+    {
+      result.push_back(qMakePair(first, last));
+    }
+  }
+  return result;
+}
+
+QSGTexture* createTexture(QQuickWindow& window, QImage const& image)
+{
+  auto* texture = window.createTextureFromImage(image);
+  Q_ASSERT(texture != nullptr);
+  return texture;
+}
+
+void setImage(QSGImageNode& node, QQuickWindow& window, QImage const& image, QRectF rect, QRectF source = QRectF())
+{
+  auto* const old_texture = node.texture();
+  auto* const texture = createTexture(window, image);
+  node.setTexture(texture);
+  node.setRect(rect);
+  node.setSourceRect(source.isNull() ? QRectF(QPointF(), texture->textureSize()) : source);
+  delete old_texture;
+}
+
+// The image is split into tiles with a texture each, a step uploads only the tiles
+// touched by the updated rectangles. Panning and zooming move the tiles around.
+class TiledImageNode final : public QSGNode
+{
+public:
+  ~TiledImageNode() override
+  {
+    for (auto* tile : tiles_)
+    {
+      delete tile->texture();
+    }
+  }
+
+  // Every tile is uploaded when all is set or the image size changes.
+  void setImage(QQuickWindow& window, QImage const& image, QRectF rect, QRectF source,
+                QVector<QRect> const& updated, bool all)
+  {
+    QSize const tiles((image.width() + c_tile_texels - 1) / c_tile_texels,
+                      (image.height() + c_tile_texels - 1) / c_tile_texels);
+    if (image.size() != image_size_)
+    {
+      resize(window, tiles.width() * tiles.height());
+      image_size_ = image.size();
+      all = true;
+    }
+
+    QPointF const scale(rect.width() / source.width(), rect.height() / source.height());
+    for (int y = 0; y < tiles.height(); ++y)
+    {
+      for (int x = 0; x < tiles.width(); ++x)
+      {
+        auto& tile = *tiles_[x + y * tiles.width()];
+        auto const texels = QRect(x * c_tile_texels, y * c_tile_texels, c_tile_texels, c_tile_texels) & image.rect();
+        auto const changed = all || std::any_of(updated.begin(), updated.end(), [&texels](QRect const& region)
+        {
+          return region.intersects(texels);
+        });
+        if (changed)
+        {
+          auto* const old_texture = tile.texture();
+          tile.setTexture(createTexture(window, image.copy(texels)));
+          delete old_texture;
+        }
+
+        auto const visible = QRectF(texels) & source;
+        if (visible.isEmpty())
+        {
+          tile.setRect(QRectF());
+          continue;
+        }
+        tile.setRect(QRectF(rect.x() + (visible.x() - source.x()) * scale.x(),
+                            rect.y() + (visible.y() - source.y()) * scale.y(),
+                            visible.width() * scale.x(), visible.height() * scale.y()));
+        tile.setSourceRect(visible.translated(-texels.topLeft()));
+      }
+    }
+  }
+
+private:
+  void resize(QQuickWindow& window, int count)
+  {
+    while (tiles_.size() > count)
+    {
+      auto* tile = tiles_.takeLast();
+      removeChildNode(tile);
+      delete tile->texture();
+      delete tile;
+    }
+    while (tiles_.size() < count)
+    {
+      auto* tile = window.createImageNode();
+      // Linear filtering would blend the tile borders with nothing.
+      tile->setFiltering(QSGTexture::Nearest);
+      appendChildNode(tile);
+      tiles_.push_back(tile);
+    }
+  }
+
+  QVector<QSGImageNode*> tiles_;
+  QSize image_size_;
+};
+
+// QSGImageNode instead of QSGSimpleTextureNode keeps the software backend working.
+class FieldNode final : public QSGNode
+{
+public:
+  explicit FieldNode(QQuickWindow& window)
+    : cells_(new TiledImageNode)
+    , selection_(window.createImageNode())
+    , overlay_(new QSGOpacityNode)
+    , grid_(window.createImageNode())
+    , coordinates_(window.createImageNode())
+    , minimap_(window.createImageNode())
+  {
+    QImage empty(1, 1, QImage::Format_ARGB32_Premultiplied);
+    empty.fill(Qt::GlobalColor::transparent);
+    for (auto* node : { selection_, grid_, coordinates_, minimap_ })
+    {
+      node->setTexture(createTexture(window, empty));
+    }
+
+    appendChildNode(cells_);
+    appendChildNode(selection_);
+    overlay_->appendChildNode(grid_);
+    overlay_->appendChildNode(coordinates_);
+    appendChildNode(overlay_);
+    appendChildNode(minimap_);
+  }
+  ~FieldNode() override
+  {
+    for (auto* node : { selection_, grid_, coordinates_, minimap_ })
+    {
+      delete node->texture();
+    }
+  }
+
+  TiledImageNode& cells() { return *cells_; }
+  QSGImageNode& selection() { return *selection_; }
+  QSGOpacityNode& overlay() { return *overlay_; }
+  QSGImageNode& grid() { return *grid_; }
+  QSGImageNode& coordinates() { return *coordinates_; }
+  QSGImageNode& minimap() { return *minimap_; }
+
+private:
+  TiledImageNode* const cells_ = nullptr;
+  QSGImageNode* const selection_ = nullptr;
+  QSGOpacityNode* const overlay_ = nullptr;
+  QSGImageNode* const grid_ = nullptr;
+  QSGImageNode* const coordinates_ = nullptr;
+  QSGImageNode* const minimap_ = nullptr;
+};
+
 } // namespace
 
+GameView::GameView(QQuickItem* parent)
+  : QQuickItem(parent)
+{
+  setFlag(ItemHasContents);
+}
+
 GameView::~GameView()
 {
   qDebug() << "~GameView()";
@@ -60,6 +266,11 @@ Logic::SizeT GameView::patternCount() const
   return game_model_->patternCount();
 }
 
+QObject* GameView::patterns()
+{
+  return &patterns_;
+}
+
 QPoint GameView::fieldCells() const
 {
   return game_model_->cells();
@@ -68,6 +279,16 @@ QPoint GameView::fieldCells() const
 void GameView::initialize(Logic::GameModelPtr game_model)
 {
   game_model_ = game_model;
+  patterns_.setCatalog(game_model_->patternCatalog());
+  if (auto const engine = qmlEngine(this))
+  {
+    // The engine owns the provider, responses of the previous game keep its cache.
+    engine->removeImageProvider(c_thumbnail_provider);
+    engine->addImageProvider(c_thumbnail_provider,
+                             new ThumbnailProvider(Utilities::Qt::makeShared<ThumbnailCache>(game_model_->patternCatalog())));
+  }
+  snapshot_ = nullptr;
+  snapshot_sequence_ = 0;
 }
 
 void GameView::setCurrentPattern(QVariant const& pattern_model)
@@ -78,47 +299,26 @@ void GameView::setCurrentPattern(QVariant const& pattern_model)
   {
     current_pattern_ = model.pattern();
     emit currentPatternChanged();
-    update();
+    invalidate(SelectionLayer);
   }
 }
 
-void GameView::paint(QPainter* painter_ptr)
+void GameView::setFillColor(QColor fill_color)
 {
-  auto& painter = *painter_ptr;
-  painter.setPen(Qt::GlobalColor::white);
-  painter.setRenderHint(QPainter::Antialiasing);
-
-  painter.save();
-  drawLifeCells(painter);
-  painter.restore();
-
-  painter.save();
-  drawSelectedCell(painter);
-  painter.restore();
-
-  auto const normalized_scale = normalizeValue(field_scale_, minScale(), maxScale());
-  if (normalized_scale < c_scale_to_hide_grid)
-  {
-    return;
-  }
-  else if (normalized_scale < 1.0)
-  {
-    painter.setOpacity(normalized_scale);
-  }
-  drawGrid(painter);
-  drawCoordinates(painter);
+  fill_color_ = fill_color;
+  invalidate(CellsLayer);
 }
 
 void GameView::setFieldOffset(QPointF field_offset)
 {
   field_offset_ = loopPos(field_offset);
-  update();
+  invalidate(AllLayers);
 }
 
 void GameView::setFieldScale(qreal field_scale)
 {
   field_scale_ = field_scale;
-  update();
+  invalidate(AllLayers);
 }
 
 QVariant GameView::patternModelAt(int idx) const
@@ -137,7 +337,7 @@ void GameView::pressed(QPointF point)
   QMatrix tmp;
   tmp.translate(cell.x() - trs.dx(), cell.y() - trs.dy());
   trs *= tmp;
-  update();
+  invalidate(SelectionLayer);
 }
 
 void GameView::rotatePattern(qreal angle)
@@ -148,7 +348,7 @@ void GameView::rotatePattern(qreal angle)
   }
   auto& trs = pattern_trs_.second;
   trs.rotate(angle);
-  update();
+  invalidate(SelectionLayer);
 }
 
 void GameView::selectPattern()
@@ -173,9 +373,14 @@ void GameView::selectPattern()
     {
       return points_.size();
     }
+    Logic::PatternBitmap const& bitmap(Logic::PatternVariant variant) const override
+    {
+      return bitmaps_.bitmap(variant);
+    }
 
   private:
     Logic::Points const points_ { QPoint() };
+    Logic::PatternBitmaps const bitmaps_ { points_ };
   };
 
   if (current_pattern_ == nullptr)
@@ -185,7 +390,7 @@ void GameView::selectPattern()
   emit patternSelected(qMakePair(current_pattern_, std::move(pattern_trs_.second)));
   pattern_trs_ = qMakePair(false, QMatrix());
   current_pattern_ = nullptr;
-  update();
+  invalidate(SelectionLayer);
 }
 
 void GameView::zoom(qreal ratio, QPointF point)
@@ -216,6 +421,12 @@ void GameView::zoom(qreal ratio, QPointF point)
                           normalized_point.y() * new_size.y()) + point);
 }
 
+void GameView::onUpdateTimeChanged(int update_time)
+{
+  update_time_ = update_time;
+  emit updateTimeChanged();
+}
+
 void GameView::onStepMade(Logic::Score scores)
 {
   if (scores != scores_)
@@ -223,9 +434,361 @@ void GameView::onStepMade(Logic::Score scores)
     scores_ = scores;
     emit scoresChanged();
   }
+
+  // Snapshots published in between were never seen, so their changes are unknown.
+  auto const& snapshot = game_model_->snapshot();
+  if (snapshot.sequence() == snapshot_sequence_)
+  {
+    return;
+  }
+  auto const consecutive = snapshot.sequence() == snapshot_sequence_ + 1;
+  snapshot_ = &snapshot;
+  snapshot_sequence_ = snapshot.sequence();
+  if (!consecutive)
+  {
+    changed_regions_.clear();
+    invalidate(CellsLayer | MinimapLayer);
+    return;
+  }
+
+  auto const& regions = snapshot.changedRegions();
+  if (regions.isEmpty())
+  {
+    return;
+  }
+  if (localRegions(regions, visibleArea(1)).isEmpty())
+  {
+    invalidate(MinimapLayer);
+    return;
+  }
+  changed_regions_ += regions;
+  if (changed_regions_.size() > c_max_changed_regions)
+  {
+    changed_regions_.clear();
+    invalidate(CellsLayer | MinimapLayer);
+    return;
+  }
+  invalidate(ChangedCellsLayer | MinimapLayer);
+}
+
+QSGNode* GameView::updatePaintNode(QSGNode* old_node, UpdatePaintNodeData*)
+{
+  if (game_model_ == nullptr || width() <= 0.0 || height() <= 0.0)
+  {
+    delete old_node;
+    return nullptr;
+  }
+
+  auto& window = *this->window();
+  auto* node = static_cast<FieldNode*>(old_node);
+  if (node == nullptr)
+  {
+    node = new FieldNode(window);
+    dirty_layers_ = AllLayers;
+  }
+  auto const bounds = boundingRect();
+
+  if (dirty_layers_ & (CellsLayer | ChangedCellsLayer))
+  {
+    auto const full_redraw = (dirty_layers_ & CellsLayer) != 0;
+    auto const* density_level = densityLevel();
+    QVector<QRect> updated;
+    if (pixelsPerCell().x() >= c_min_sprite_pixels)
+    {
+      renderCellSprites(full_redraw, updated);
+      node->cells().setImage(window, sprites_image_, bounds, QRectF(sprites_image_.rect()), updated, full_redraw);
+    }
+    else if (density_level != nullptr)
+    {
+      auto const source = renderDensity(density_image_, *density_level);
+      node->cells().setImage(window, density_image_, bounds, source, updated, true);
+    }
+    else
+    {
+      auto const source = renderCells(full_redraw, updated);
+      node->cells().setImage(window, cells_image_, bounds, source, updated, full_redraw);
+    }
+    changed_regions_.clear();
+  }
+  if ((dirty_layers_ & MinimapLayer) && snapshot_ != nullptr)
+  {
+    setImage(node->minimap(), window, renderMinimap(), minimapRect());
+  }
+  if (dirty_layers_ & SelectionLayer)
+  {
+    setImage(node->selection(), window, renderSelection(), bounds);
+  }
+
+  auto const normalized_scale = normalizeValue(field_scale_, minScale(), maxScale());
+  auto const overlay_visible = normalized_scale >= c_scale_to_hide_grid;
+  node->overlay().setOpacity(overlay_visible ? normalized_scale : 0.0);
+  if (overlay_visible && (dirty_layers_ & GridLayer))
+  {
+    setImage(node->grid(), window, renderGrid(), bounds);
+  }
+  if (overlay_visible && (dirty_layers_ & CoordinatesLayer))
+  {
+    setImage(node->coordinates(), window, renderCoordinates(), bounds);
+  }
+  dirty_layers_ = overlay_visible ? 0 : dirty_layers_ & (GridLayer | CoordinatesLayer);
+  return node;
+}
+
+void GameView::geometryChanged(QRectF const& new_geometry, QRectF const& old_geometry)
+{
+  QQuickItem::geometryChanged(new_geometry, old_geometry);
+  invalidate(AllLayers);
+}
+
+void GameView::invalidate(uint8_t layers)
+{
+  dirty_layers_ |= layers;
   update();
 }
 
+QImage GameView::createLayer() const
+{
+  auto const pixel_ratio = window()->effectiveDevicePixelRatio();
+  QImage layer((size() * pixel_ratio).toSize(), QImage::Format_ARGB32_Premultiplied);
+  layer.setDevicePixelRatio(pixel_ratio);
+  layer.fill(Qt::GlobalColor::transparent);
+  return layer;
+}
+
+GameView::VisibleArea GameView::visibleArea(int cells_per_texel) const
+{
+  auto const pixels_per_texel = pixelsPerCell() * cells_per_texel;
+  auto const first_pixel = loopPos(-field_offset_);
+  QPointF const first_texel(first_pixel.x() / pixels_per_texel.x(), first_pixel.y() / pixels_per_texel.y());
+
+  VisibleArea area;
+  area.origin_ = QPoint(static_cast<int>(first_texel.x()), static_cast<int>(first_texel.y()));
+  area.shift_ = first_texel - area.origin_;
+  area.visible_ = QSizeF(width() / pixels_per_texel.x(), height() / pixels_per_texel.y());
+  area.covered_ = QSize(static_cast<int>(std::ceil(area.shift_.x() + area.visible_.width())),
+                        static_cast<int>(std::ceil(area.shift_.y() + area.visible_.height())));
+  return area;
+}
+
+// Changed field regions in coordinates relative to the visible area origin.
+QVector<QRect> GameView::localRegions(QVector<QRect> const& regions, VisibleArea const& area) const
+{
+  auto const field_cells = fieldCells();
+  QVector<QRect> result;
+  for (auto const& region : regions)
+  {
+    auto const rows = coveredSpans(region.y(), region.height(), area.origin_.y(), area.covered_.height(), field_cells.y());
+    auto const columns = coveredSpans(region.x(), region.width(), area.origin_.x(), area.covered_.width(), field_cells.x());
+    for (auto const& row : rows)
+    {
+      for (auto const& column : columns)
+      {
+        result.push_back(QRect(column.first, row.first, column.second - column.first, row.second - row.first));
+      }
+    }
+  }
+  return result;
+}
+
+// One texel per visible cell rasterised from the snapshot units, only the changed
+// regions are cleared and filled again unless a full redraw is requested. The returned
+// source rectangle drops the partially visible border cells, updated gets the redrawn
+// texels.
+QRectF GameView::renderCells(bool full_redraw, QVector<QRect>& updated)
+{
+  auto const area = visibleArea(1);
+  if (cells_image_.size() != area.covered_)
+  {
+    cells_image_ = QImage(area.covered_, QImage::Format_Indexed8);
+    full_redraw = true;
+  }
+  QVector<QRgb> color_table { fill_color_.rgba() };
+  for (Logic::PlayerId player = 0; player < Logic::c_max_player_count; ++player)
+  {
+    color_table.push_back(playerColor(player).rgba());
+  }
+  cells_image_.setColorTable(color_table);
+
+  auto const regions = full_redraw
+      ? QVector<QRect> { QRect(QPoint(), area.covered_) }
+      : localRegions(changed_regions_, area);
+  updated = regions;
+  auto const field_cells = fieldCells();
+  for (auto const& region : regions)
+  {
+    for (int y = region.top(); y <= region.bottom(); ++y)
+    {
+      std::memset(cells_image_.scanLine(y) + region.left(), 0, static_cast<size_t>(region.width()));
+    }
+    if (snapshot_ == nullptr)
+    {
+      continue;
+    }
+    for (auto const unit : snapshot_->lifeUnitsIn(region.translated(area.origin_)))
+    {
+      auto const column = (unit.x() - area.origin_.x() + field_cells.x()) % field_cells.x();
+      auto const row = (unit.y() - area.origin_.y() + field_cells.y()) % field_cells.y();
+      cells_image_.scanLine(row)[column] = static_cast<uchar>(unit.player() + 1);
+    }
+  }
+  return QRectF(area.shift_, area.visible_);
+}
+
+// At coarse zoom levels every texel is a block of the density pyramid, so the cost
+// depends on the screen size only.
+QRectF GameView::renderDensity(QImage& image, Logic::DensityLevel const& level) const
+{
+  auto const area = visibleArea(level.block_size_);
+  if (image.size() != area.covered_)
+  {
+    image = QImage(area.covered_, QImage::Format_RGB32);
+  }
+  for (int y = 0; y < area.covered_.height(); ++y)
+  {
+    auto* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+    auto const row = (area.origin_.y() + y) % level.blocks_.y();
+    for (int x = 0; x < area.covered_.width(); ++x)
+    {
+      auto const column = (area.origin_.x() + x) % level.blocks_.x();
+      line[x] = densityColor(fill_color_, level, static_cast<size_t>(column + row * level.blocks_.x()));
+    }
+  }
+  return QRectF(area.shift_, area.visible_);
+}
+
+QImage GameView::renderMinimap() const
+{
+  auto const& levels = snapshot_->densityLevels();
+  auto const rect = minimapRect();
+  auto level_iter = std::find_if(levels.begin(), levels.end(), [&rect](Logic::DensityLevel const& level)
+  {
+    return level.blocks_.x() <= rect.width() && level.blocks_.y() <= rect.height();
+  });
+  auto const& level = (level_iter == levels.end()) ? levels.back() : *level_iter;
+
+  QImage blocks(level.blocks_.x(), level.blocks_.y(), QImage::Format_RGB32);
+  for (int y = 0; y < blocks.height(); ++y)
+  {
+    auto* line = reinterpret_cast<QRgb*>(blocks.scanLine(y));
+    for (int x = 0; x < blocks.width(); ++x)
+    {
+      line[x] = densityColor(fill_color_, level, static_cast<size_t>(x + y * level.blocks_.x()));
+    }
+  }
+
+  auto const pixel_ratio = window()->effectiveDevicePixelRatio();
+  auto minimap = blocks.scaled((rect.size() * pixel_ratio).toSize());
+  minimap.setDevicePixelRatio(pixel_ratio);
+
+  auto const field_size = fieldSize();
+  auto const first_pixel = loopPos(-field_offset_);
+  QRectF const viewport(first_pixel.x() / field_size.x() * rect.width(),
+                        first_pixel.y() / field_size.y() * rect.height(),
+                        width() / field_size.x() * rect.width(),
+                        height() / field_size.y() * rect.height());
+  QPainter painter(&minimap);
+  painter.setPen(c_pattern_selection_color);
+  for (auto const& wrap : { QPointF(0.0, 0.0), QPointF(-rect.width(), 0.0),
+                            QPointF(0.0, -rect.height()), QPointF(-rect.width(), -rect.height()) })
+  {
+    painter.drawRect(viewport.translated(wrap));
+  }
+  painter.setPen(Qt::GlobalColor::white);
+  painter.drawRect(QRectF(QPointF(), rect.size()));
+  return minimap;
+}
+
+// Zoomed in cells are drawn as sprites, only the units inside the visible,
+// possibly wrapped, rectangles are fetched from the model. Updated gets the
+// redrawn device pixels like in renderCells().
+void GameView::renderCellSprites(bool full_redraw, QVector<QRect>& updated)
+{
+  auto const pixel_ratio = window()->effectiveDevicePixelRatio();
+  auto const pixels_per_cell = pixelsPerCell();
+  if (full_redraw || sprites_image_.size() != (size() * pixel_ratio).toSize())
+  {
+    full_redraw = true;
+    sprites_image_ = createLayer();
+    cell_sprites_.clear();
+    auto const sprite_size = (QSizeF(pixels_per_cell.x(), pixels_per_cell.y()) * pixel_ratio).toSize();
+    for (Logic::PlayerId player = 0; player < Logic::c_max_player_count; ++player)
+    {
+      QImage sprite(sprite_size, QImage::Format_ARGB32_Premultiplied);
+      sprite.setDevicePixelRatio(pixel_ratio);
+      sprite.fill(Qt::GlobalColor::transparent);
+      QPainter painter(&sprite);
+      painter.setRenderHint(QPainter::Antialiasing);
+      painter.setPen(playerColor(player));
+      painter.setBrush(QBrush(Qt::GlobalColor::white));
+      auto const radius = pixels_per_cell * c_life_pixels_ratio;
+      painter.drawEllipse(pixels_per_cell / 2.0, radius.x(), radius.y());
+      cell_sprites_.push_back(std::move(sprite));
+    }
+  }
+
+  auto const area = visibleArea(1);
+  auto const regions = full_redraw
+      ? QVector<QRect> { QRect(QPoint(), area.covered_) }
+      : localRegions(changed_regions_, area);
+  auto const field_cells = fieldCells();
+  QPointF const shift(area.shift_.x() * pixels_per_cell.x(), area.shift_.y() * pixels_per_cell.y());
+
+  QPainter painter(&sprites_image_);
+  for (auto const& region : regions)
+  {
+    QRectF const pixels(region.left() * pixels_per_cell.x() - shift.x(),
+                        region.top() * pixels_per_cell.y() - shift.y(),
+                        region.width() * pixels_per_cell.x(),
+                        region.height() * pixels_per_cell.y());
+    updated.push_back(QRectF(pixels.topLeft() * pixel_ratio, pixels.size() * pixel_ratio).toAlignedRect());
+    painter.setClipRect(pixels);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.fillRect(pixels, fill_color_);
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+    if (snapshot_ == nullptr)
+    {
+      continue;
+    }
+    for (auto const unit : snapshot_->lifeUnitsIn(region.translated(area.origin_)))
+    {
+      auto const column = (unit.x() - area.origin_.x() + field_cells.x()) % field_cells.x();
+      auto const row = (unit.y() - area.origin_.y() + field_cells.y()) % field_cells.y();
+      QPointF const position(column * pixels_per_cell.x() - shift.x(), row * pixels_per_cell.y() - shift.y());
+      painter.drawImage(position, cell_sprites_.at(unit.player()));
+    }
+  }
+}
+
+QImage GameView::renderSelection() const
+{
+  auto layer = createLayer();
+  QPainter painter(&layer);
+  painter.setRenderHint(QPainter::Antialiasing);
+  drawSelectedCell(painter);
+  return layer;
+}
+
+QImage GameView::renderGrid() const
+{
+  auto layer = createLayer();
+  QPainter painter(&layer);
+  painter.setPen(Qt::GlobalColor::white);
+  painter.setRenderHint(QPainter::Antialiasing);
+  drawGrid(painter);
+  return layer;
+}
+
+QImage GameView::renderCoordinates() const
+{
+  auto layer = createLayer();
+  QPainter painter(&layer);
+  painter.setPen(Qt::GlobalColor::white);
+  painter.setRenderHint(QPainter::Antialiasing);
+  drawCoordinates(painter);
+  return layer;
+}
+
 void GameView::drawGrid(QPainter& painter) const
 {
   auto const window = size();
@@ -245,16 +808,6 @@ void GameView::drawGrid(QPainter& painter) const
   }
 }
 
-void GameView::drawLifeCells(QPainter& painter) const
-{
-  painter.setBrush(QBrush(Qt::GlobalColor::white));
-  for (auto const unit : game_model_->lifeUnits())
-  {
-    painter.setPen(playerColor(unit.player()));
-    drawFilledCircle(painter, QPoint(unit.x(), unit.y()));
-  }
-}
-
 void GameView::drawSelectedCell(QPainter& painter) const
 {
   if (!pattern_trs_.first)
@@ -323,6 +876,34 @@ void GameView::drawCoordinates(QPainter& painter) const
   }
 }
 
+QRectF GameView::minimapRect() const
+{
+  auto const cells = fieldCells();
+  QSizeF const size(c_minimap_pixels, c_minimap_pixels * cells.y() / cells.x());
+  return QRectF(QPointF(width() - size.width() - c_minimap_margin, height() - size.height() - c_minimap_margin), size);
+}
+
+Logic::DensityLevel const* GameView::densityLevel() const
+{
+  if (snapshot_ == nullptr)
+  {
+    return nullptr;
+  }
+  // Once the cells outnumber the device pixels the finest level whose blocks still
+  // cover a pixel is shown, so the texture never has more texels than the screen.
+  auto const cells_per_pixel = 1.0 / (pixelsPerCell().x() * window()->effectiveDevicePixelRatio());
+  if (cells_per_pixel < 1.0)
+  {
+    return nullptr;
+  }
+  auto const& levels = snapshot_->densityLevels();
+  auto const found = std::find_if(levels.begin(), levels.end(), [cells_per_pixel](Logic::DensityLevel const& level)
+  {
+    return level.block_size_ >= cells_per_pixel;
+  });
+  return found == levels.end() ? &levels.back() : &*found;
+}
+
 QPointF GameView::fieldSize() const
 {
   return QPointF(fieldCells().x() * pixelsPerCell().x(),
@@ -367,12 +948,12 @@ qreal GameView::maxScale() const
                   window()->size().height() / min_cells.y());
 }
 
+// The whole field fits the window, past the device pixels it's drawn from the
+// density pyramid at a cost independent of the population.
 qreal GameView::minScale() const
 {
   auto const cells = game_model_->cells();
-  auto const max_cells_x = std::min(cells.x(), c_max_cells_in_screen);
-  auto const max_cells_y = std::min(cells.y(), c_max_cells_in_screen);
-  QPointF const max_cells(max_cells_x * c_pixels_per_cell.x(), max_cells_y * c_pixels_per_cell.y());
+  QPointF const max_cells(cells.x() * c_pixels_per_cell.x(), cells.y() * c_pixels_per_cell.y());
   return std::max(window()->size().width() / max_cells.x(),
                   window()->size().height() / max_cells.y());
 }
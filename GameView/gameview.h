@@ -1,12 +1,16 @@
 #ifndef GAMEVIEW_H
 #define GAMEVIEW_H
 
-#include <QQuickPaintedItem>
+#include <QQuickItem>
+#include <QColor>
+#include <QImage>
+#include <QPainter>
 #include <QPoint>
 #include <QMatrix>
 #include <QPointer>
 
 #include "../GameLogic/gamemodel.h"
+#include "patternlistmodel.h"
 
 namespace View {
 
@@ -44,28 +48,33 @@ private:
   Logic::PatternPtr pattern_ptr_;
 };
 
-class GameView : public QQuickPaintedItem
+class GameView : public QQuickItem
 {
   Q_OBJECT
+  Q_PROPERTY(QColor fillColor MEMBER fill_color_ WRITE setFillColor)
   Q_PROPERTY(QVariant currentPattern READ currentPattern WRITE setCurrentPattern NOTIFY currentPatternChanged)
   Q_PROPERTY(int patternCount READ patternCount CONSTANT)
+  Q_PROPERTY(QObject* patterns READ patterns CONSTANT)
   Q_PROPERTY(QPointF fieldOffset MEMBER field_offset_ WRITE setFieldOffset)
   Q_PROPERTY(qreal fieldScale MEMBER field_scale_ WRITE setFieldScale)
   Q_PROPERTY(qreal maxScale READ maxScale CONSTANT)
   Q_PROPERTY(qreal minScale READ minScale CONSTANT)
   Q_PROPERTY(int scores MEMBER scores_ NOTIFY scoresChanged)
+  // Milliseconds per step once the game slowed down to the engine, zero before.
+  Q_PROPERTY(int updateTime MEMBER update_time_ NOTIFY updateTimeChanged)
 
 public:
-  using QQuickPaintedItem::QQuickPaintedItem;
+  explicit GameView(QQuickItem* parent = nullptr);
   ~GameView() override;
 
   QVariant currentPattern() const;
   Logic::SizeT patternCount() const;
+  QObject* patterns();
   QPoint fieldCells() const;
 
   void initialize(Logic::GameModelPtr game_model);
   void setCurrentPattern(QVariant const& pattern_model);
-  void paint(QPainter* painter_ptr) override;
+  void setFillColor(QColor fill_color);
   void setFieldOffset(QPointF field_offset);
   void setFieldScale(qreal ratio);
 
@@ -77,21 +86,62 @@ public:
 
 public slots:
   void onStepMade(Logic::Score scores);
+  void onUpdateTimeChanged(int update_time);
+
+protected:
+  QSGNode* updatePaintNode(QSGNode* old_node, UpdatePaintNodeData* data) override;
+  void geometryChanged(QRectF const& new_geometry, QRectF const& old_geometry) override;
 
 signals:
   void currentPatternChanged();
   void scoresChanged();
+  void updateTimeChanged();
   bool patternSelected(Logic::PatternTrs pattern_trs);
   bool stop();
+  // Runs the generations as fast as the engine allows, only the last one is shown.
+  void runGenerations(int generations);
+  void jumpTo(int generation);
 
 private:
   using MaybeTRS = QPair<bool, QMatrix>;
+  enum Layer : uint8_t
+  {
+    CellsLayer       = 1 << 0,
+    SelectionLayer   = 1 << 1,
+    GridLayer        = 1 << 2,
+    CoordinatesLayer = 1 << 3,
+    MinimapLayer     = 1 << 4,
+    AllLayers        = CellsLayer | SelectionLayer | GridLayer | CoordinatesLayer | MinimapLayer,
+    // Only changed_regions_ of the cells layer have to be redrawn.
+    ChangedCellsLayer = 1 << 5
+  };
+  struct VisibleArea
+  {
+    QPoint origin_;
+    QPointF shift_;
+    QSizeF visible_;
+    QSize covered_;
+  };
+
+  void invalidate(uint8_t layers);
+  QImage createLayer() const;
+  VisibleArea visibleArea(int cells_per_texel) const;
+  QVector<QRect> localRegions(QVector<QRect> const& regions, VisibleArea const& area) const;
+  QRectF renderCells(bool full_redraw, QVector<QRect>& updated);
+  void renderCellSprites(bool full_redraw, QVector<QRect>& updated);
+  QRectF renderDensity(QImage& image, Logic::DensityLevel const& level) const;
+  QImage renderMinimap() const;
+  QImage renderSelection() const;
+  QImage renderGrid() const;
+  QImage renderCoordinates() const;
+
   void drawGrid(QPainter& painter) const;
-  void drawLifeCells(QPainter& painter) const;
   void drawSelectedCell(QPainter& painter) const;
   void drawFilledCircle(QPainter& painer, QPoint cell) const;
   void drawCoordinates(QPainter& painter) const;
 
+  QRectF minimapRect() const;
+  Logic::DensityLevel const* densityLevel() const;
   QPointF fieldSize() const;
   QPoint cellsOnTheScreen() const;
   QPointF cellOffset() const;
@@ -101,12 +151,24 @@ private:
   qreal maxScale() const;
   qreal minScale() const;
 
+  QColor fill_color_ = Qt::GlobalColor::black;
+  QImage cells_image_;
+  QImage density_image_;
+  QImage sprites_image_;
+  QVector<QImage> cell_sprites_;
+  QVector<QRect> changed_regions_;
+  uint8_t dirty_layers_ = AllLayers;
   QPointF field_offset_;
   qreal field_scale_ = 1.0;
   MaybeTRS pattern_trs_;
   Logic::PatternPtr current_pattern_;
+  PatternListModel patterns_;
   Logic::GameModelPtr game_model_;
+  // Owned by the view until the next game_model_->snapshot() call.
+  Logic::LifeSnapshot const* snapshot_ = nullptr;
+  uint64_t snapshot_sequence_ = 0;
   Logic::Score scores_ = 0;
+  int update_time_ = 0;
 };
 using GameViewPtr = QPointer<GameView>;
 
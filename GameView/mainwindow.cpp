@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <QQmlEngine>
 #include <QQmlContext>
 #include <QScopedPointer>
@@ -68,6 +70,16 @@ QQuickItem* MainWindow::createGame(GameParams* game_params)
           game_controller_.data(), &Logic::GameController::onStop);
   connect(game_controller_.data(), &Logic::GameController::stepMade,
           game_view_.data(), &GameView::onStepMade);
+  connect(game_controller_.data(), &Logic::GameController::updateTimeChanged,
+          game_view_.data(), &GameView::onUpdateTimeChanged);
+  connect(game_view_.data(), &GameView::runGenerations, game_controller_.data(), [this](int generations)
+  {
+    game_controller_->runGenerations(static_cast<Logic::StepId>(std::max(generations, 0)));
+  });
+  connect(game_view_.data(), &GameView::jumpTo, game_controller_.data(), [this](int generation)
+  {
+    game_controller_->jumpTo(static_cast<Logic::StepId>(std::max(generation, 0)));
+  });
   suppressSignals(game_network_.data(), true);
   return game_window_.data();
 }
@@ -111,6 +123,8 @@ void MainWindow::createGameController(GameParams const& params)
     , params.gameSpeed()
     , params.initialScores()
     , params.currentPlayer()
+    , Logic::c_default_lookahead
+    , static_cast<Logic::StepPolicy>(params.stepPolicy())
     });
 }
 
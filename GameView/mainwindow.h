@@ -18,6 +18,7 @@ class GameParams : public QObject
   Q_PROPERTY(int gameSpeed READ gameSpeed WRITE setGameSpeed)
   Q_PROPERTY(int playerCount READ playerCount WRITE setPlayerCount)
   Q_PROPERTY(int initialScores READ initialScores WRITE setInitialScores)
+  Q_PROPERTY(int stepPolicy READ stepPolicy WRITE setStepPolicy)
 
 public:
   using QObject::QObject;
@@ -38,6 +39,11 @@ public:
   auto gameSpeed() const { return game_params_.game_speed_; }
   auto playerCount() const { return game_params_.player_count_; }
   auto initialScores() const { return game_params_.initial_scores_; }
+  // Peers have to keep the same cadence, lobby games always catch up.
+  auto stepPolicy() const
+  {
+    return static_cast<int>(lobby_ == nullptr ? step_policy_ : Logic::StepPolicy::CatchUp);
+  }
 
   auto lobby() { return lobby_; }
   void setName(QString name) { game_params_.name_ = std::move(name); }
@@ -51,6 +57,10 @@ public:
   {
     game_params_.initial_scores_ = static_cast<Logic::Score>(scores);
   }
+  void setStepPolicy(int step_policy)
+  {
+    step_policy_ = static_cast<Logic::StepPolicy>(step_policy);
+  }
 
 public slots:
   void setLobby(Network::LobbyPtr lobby);
@@ -68,6 +78,7 @@ signals:
 private:
   Network::LobbyPtr lobby_;
   Network::LobbyParams game_params_;
+  Logic::StepPolicy step_policy_ = Logic::StepPolicy::CatchUp;
 };
 
 class MainWindow : public QQuickItem
@@ -0,0 +1,194 @@
+#include <algorithm>
+
+#include <QtConcurrent>
+
+#include "patternlistmodel.h"
+
+namespace View {
+
+namespace {
+
+Logic::Score toCells(qreal cells)
+{
+  return (cells >= static_cast<qreal>(std::numeric_limits<Logic::Score>::max()))
+      ? std::numeric_limits<Logic::Score>::max()
+      : static_cast<Logic::Score>(std::max<qreal>(cells, 0.0));
+}
+
+} // namespace
+
+PatternListModel::PatternListModel(QObject* parent)
+  : QAbstractListModel(parent)
+{
+  connect(&index_watcher_, &QFutureWatcher<PatternIndexPtr>::finished, this, &PatternListModel::onIndexBuilt);
+}
+
+void PatternListModel::setCatalog(Utilities::PatternsPtr catalog)
+{
+  beginResetModel();
+  catalog_ = std::move(catalog);
+  index_.reset();
+  rows_.clear();
+  endResetModel();
+  emit readyChanged();
+
+  auto const patterns = catalog_;
+  index_watcher_.setFuture(QtConcurrent::run([patterns]
+  {
+    return PatternIndexPtr(new Utilities::PatternIndex(*patterns));
+  }));
+}
+
+void PatternListModel::setText(QString text)
+{
+  if (query_.text_ != text)
+  {
+    query_.text_ = std::move(text);
+    update();
+  }
+}
+
+void PatternListModel::setMinSize(int size)
+{
+  if (query_.min_size_ != size)
+  {
+    query_.min_size_ = size;
+    update();
+  }
+}
+
+void PatternListModel::setMaxSize(int size)
+{
+  if (query_.max_size_ != size)
+  {
+    query_.max_size_ = size;
+    update();
+  }
+}
+
+void PatternListModel::setMinCells(qreal cells)
+{
+  if (query_.min_cells_ != toCells(cells))
+  {
+    query_.min_cells_ = toCells(cells);
+    update();
+  }
+}
+
+void PatternListModel::setMaxCells(qreal cells)
+{
+  if (query_.max_cells_ != toCells(cells))
+  {
+    query_.max_cells_ = toCells(cells);
+    update();
+  }
+}
+
+void PatternListModel::setGrowth(int growth)
+{
+  if (query_.growth_ != static_cast<Utilities::PatternGrowth>(growth))
+  {
+    query_.growth_ = static_cast<Utilities::PatternGrowth>(growth);
+    update();
+  }
+}
+
+int PatternListModel::rowCount(QModelIndex const& parent) const
+{
+  return parent.isValid() ? 0 : rows_.size();
+}
+
+QVariant PatternListModel::data(QModelIndex const& index, int role) const
+{
+  if (!index.isValid() || index.row() >= rows_.size())
+  {
+    return QVariant();
+  }
+  auto const idx = rows_[index.row()];
+  auto const& info = catalog_->patternInfoAt(idx);
+  switch (role)
+  {
+  case PatternIndexRole:
+    return idx;
+  case Qt::DisplayRole:
+  case NameRole:
+    return info.name_;
+  case SizeRole:
+    return info.size_;
+  case CellsRole:
+    return static_cast<qreal>(info.cells_);
+  case GrowthRole:
+    return static_cast<int>(info.behaviour_.growth_);
+  case PeriodRole:
+    return info.behaviour_.period_;
+  }
+  return QVariant();
+}
+
+QHash<int, QByteArray> PatternListModel::roleNames() const
+{
+  return
+  {
+    { PatternIndexRole, "patternIndex" },
+    { NameRole, "name" },
+    { SizeRole, "size" },
+    { CellsRole, "cells" },
+    { GrowthRole, "growth" },
+    { PeriodRole, "period" },
+  };
+}
+
+void PatternListModel::onIndexBuilt()
+{
+  index_ = index_watcher_.result();
+  emit readyChanged();
+  update();
+}
+
+// Both lists are in the catalog order, so one pass finds the runs to remove and insert.
+void PatternListModel::update()
+{
+  emit queryChanged();
+  if (index_ == nullptr)
+  {
+    return;
+  }
+  auto const found = index_->find(query_);
+  int row = 0;
+  int next = 0;
+  while (row < rows_.size() || next < found.size())
+  {
+    if (row < rows_.size() && next < found.size() && rows_[row] == found[next])
+    {
+      ++row;
+      ++next;
+    }
+    else if (next == found.size() || (row < rows_.size() && rows_[row] < found[next]))
+    {
+      auto last = row;
+      while (last < rows_.size() && (next == found.size() || rows_[last] < found[next]))
+      {
+        ++last;
+      }
+      beginRemoveRows(QModelIndex(), row, last - 1);
+      rows_.remove(row, last - row);
+      endRemoveRows();
+    }
+    else
+    {
+      auto last = next;
+      while (last < found.size() && (row == rows_.size() || found[last] < rows_[row]))
+      {
+        ++last;
+      }
+      beginInsertRows(QModelIndex(), row, row + last - next - 1);
+      rows_.insert(row, last - next, 0);
+      std::copy(found.begin() + next, found.begin() + last, rows_.begin() + row);
+      endInsertRows();
+      row += last - next;
+      next = last;
+    }
+  }
+}
+
+} // View
@@ -0,0 +1,81 @@
+#ifndef PATTERNLISTMODEL_H
+#define PATTERNLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+
+#include "../Utilities/patternindex.h"
+
+namespace View {
+
+// Patterns of the catalog matching the search, the rows of a new result are
+// inserted and removed in runs instead of resetting the model, so the view keeps
+// its delegates and position. The index is built in the background, the model is
+// empty until it is ready.
+class PatternListModel : public QAbstractListModel
+{
+  Q_OBJECT
+  Q_PROPERTY(QString text READ text WRITE setText NOTIFY queryChanged)
+  Q_PROPERTY(int minSize READ minSize WRITE setMinSize NOTIFY queryChanged)
+  Q_PROPERTY(int maxSize READ maxSize WRITE setMaxSize NOTIFY queryChanged)
+  Q_PROPERTY(qreal minCells READ minCells WRITE setMinCells NOTIFY queryChanged)
+  Q_PROPERTY(qreal maxCells READ maxCells WRITE setMaxCells NOTIFY queryChanged)
+  Q_PROPERTY(int growth READ growth WRITE setGrowth NOTIFY queryChanged)
+  Q_PROPERTY(bool ready READ ready NOTIFY readyChanged)
+
+public:
+  enum Role
+  {
+    PatternIndexRole = Qt::UserRole + 1,
+    NameRole,
+    SizeRole,
+    CellsRole,
+    GrowthRole,
+    PeriodRole,
+  };
+
+  explicit PatternListModel(QObject* parent = nullptr);
+
+  void setCatalog(Utilities::PatternsPtr catalog);
+
+  QString text() const { return query_.text_; }
+  int minSize() const { return query_.min_size_; }
+  int maxSize() const { return query_.max_size_; }
+  qreal minCells() const { return static_cast<qreal>(query_.min_cells_); }
+  qreal maxCells() const { return static_cast<qreal>(query_.max_cells_); }
+  int growth() const { return static_cast<int>(query_.growth_); }
+  bool ready() const { return index_ != nullptr; }
+
+  void setText(QString text);
+  void setMinSize(int size);
+  void setMaxSize(int size);
+  void setMinCells(qreal cells);
+  void setMaxCells(qreal cells);
+  void setGrowth(int growth);
+
+public: // QAbstractListModel
+  int rowCount(QModelIndex const& parent = QModelIndex()) const override;
+  QVariant data(QModelIndex const& index, int role) const override;
+  QHash<int, QByteArray> roleNames() const override;
+
+signals:
+  void queryChanged();
+  void readyChanged();
+
+private:
+  using PatternIndexPtr = QSharedPointer<Utilities::PatternIndex const>;
+
+  void onIndexBuilt();
+  void update();
+
+  Utilities::PatternsPtr catalog_;
+  PatternIndexPtr index_;
+  QFutureWatcher<PatternIndexPtr> index_watcher_;
+  Utilities::PatternQuery query_;
+  QVector<Logic::SizeT> rows_;
+};
+
+} // View
+
+#endif // PATTERNLISTMODEL_H
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <vector>
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QResource>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+
+#include "../Utilities/mappedfile.h"
+#include "thumbnailcache.h"
+
+namespace View {
+
+namespace {
+
+constexpr int const c_thumbnail_pixels = 64;
+constexpr int const c_cached_thumbnails = 4096;
+// Bumped with every change of render(), thumbnails saved by older versions are ignored.
+constexpr int const c_renderer_version = 1;
+constexpr QRgb const c_cell_color = qRgb(0, 0, 0);
+// Downscaled pixels covering a single cell are still visible.
+constexpr int const c_min_alpha = 96;
+
+QString cacheDir()
+{
+  auto const location = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  if (location.isEmpty())
+  {
+    return QString();
+  }
+  auto const dir = location + QStringLiteral("/thumbnails");
+  return QDir().mkpath(dir) ? dir : QString();
+}
+
+// Compressed resources are hashed as they are stored, they are as unique as the content.
+QByteArray contentHash(QString const& path)
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  if (path.startsWith(QLatin1Char(':')))
+  {
+    QResource const resource(path);
+    if (!resource.isValid())
+    {
+      return QByteArray();
+    }
+    hash.addData(reinterpret_cast<char const*>(resource.data()), static_cast<int>(resource.size()));
+  }
+  else
+  {
+    Utilities::MappedFile const file(path);
+    if (!file.isValid())
+    {
+      return QByteArray();
+    }
+    hash.addData(file.bytes());
+  }
+  return hash.result().toHex();
+}
+
+} // namespace
+
+ThumbnailCache::ThumbnailCache(Utilities::PatternsPtr catalog)
+  : catalog_(std::move(catalog))
+  , cache_dir_(cacheDir())
+  , images_(c_cached_thumbnails)
+{
+  // The engine keeps the other cores, browsing shouldn't slow the game down.
+  pool_.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 4));
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+  pool_.clear();
+  pool_.waitForDone();
+}
+
+QImage ThumbnailCache::thumbnail(Logic::SizeT idx)
+{
+  {
+    QMutexLocker lock(&mutex_);
+    if (auto const image = images_.object(idx))
+    {
+      return *image;
+    }
+  }
+  if (idx < 0 || idx >= catalog_->patternCount())
+  {
+    return QImage();
+  }
+
+  // Two requests of the same pattern may render it twice, the first one stored is kept.
+  auto const path = cachePath(catalog_->patternInfoAt(idx));
+  QImage image;
+  if (path.isEmpty() || !image.load(path, "PNG") || image.size() != QSize(c_thumbnail_pixels, c_thumbnail_pixels))
+  {
+    image = render(*catalog_->parsePatternAt(idx));
+    if (!path.isEmpty())
+    {
+      // Written aside and renamed, other processes never read a partial file.
+      QSaveFile file(path);
+      if (!(file.open(QIODevice::WriteOnly) && image.save(&file, "PNG") && file.commit()))
+      {
+        qDebug() << "Impossible to cache the thumbnail" << path;
+      }
+    }
+  }
+
+  QMutexLocker lock(&mutex_);
+  if (auto const cached = images_.object(idx))
+  {
+    return *cached;
+  }
+  images_.insert(idx, new QImage(image));
+  return image;
+}
+
+// The pattern is fit into the thumbnail keeping its aspect. Small patterns get
+// square blocks per cell, big ones sum the cells of every pixel into its alpha.
+QImage ThumbnailCache::render(Logic::Pattern const& pattern) const
+{
+  QImage image(c_thumbnail_pixels, c_thumbnail_pixels, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+
+  auto const& bitmap = pattern.bitmap(0);
+  auto const side = std::max(1, std::max(bitmap.size_.x(), bitmap.size_.y()));
+  auto const pixels_per_cell = std::max(1, c_thumbnail_pixels / side);
+  auto const cells_per_pixel = (side + c_thumbnail_pixels - 1) / c_thumbnail_pixels;
+  auto const margin = [pixels_per_cell, cells_per_pixel](int cells)
+  {
+    return (c_thumbnail_pixels - (cells * pixels_per_cell + cells_per_pixel - 1) / cells_per_pixel) / 2;
+  };
+  auto const margin_x = margin(bitmap.size_.x());
+  auto const margin_y = margin(bitmap.size_.y());
+
+  std::vector<int> pixel_cells(c_thumbnail_pixels * c_thumbnail_pixels, 0);
+  for (size_t idx = 0; idx < bitmap.words_.size(); ++idx)
+  {
+    auto const row = static_cast<int>(bitmap.rows_[idx]);
+    auto const column = static_cast<int>(bitmap.columns_[idx]);
+    for (auto word = bitmap.words_[idx]; word != 0; word &= word - 1)
+    {
+      auto const bit = static_cast<int>(qCountTrailingZeroBits(word));
+      auto const x = margin_x + (column + bit) * pixels_per_cell / cells_per_pixel;
+      auto const y = margin_y + row * pixels_per_cell / cells_per_pixel;
+      for (int dy = 0; dy < pixels_per_cell; ++dy)
+      {
+        for (int dx = 0; dx < pixels_per_cell; ++dx)
+        {
+          ++pixel_cells[static_cast<size_t>((y + dy) * c_thumbnail_pixels + x + dx)];
+        }
+      }
+    }
+  }
+
+  auto const full_pixel = cells_per_pixel * cells_per_pixel;
+  for (int y = 0; y < c_thumbnail_pixels; ++y)
+  {
+    auto const line = reinterpret_cast<QRgb*>(image.scanLine(y));
+    for (int x = 0; x < c_thumbnail_pixels; ++x)
+    {
+      auto const cells = pixel_cells[static_cast<size_t>(y * c_thumbnail_pixels + x)];
+      if (cells > 0)
+      {
+        auto const alpha = c_min_alpha + (255 - c_min_alpha) * std::min(cells, full_pixel) / full_pixel;
+        line[x] = qPremultiply(qRgba(qRed(c_cell_color), qGreen(c_cell_color), qBlue(c_cell_color), alpha));
+      }
+    }
+  }
+  return image;
+}
+
+QString ThumbnailCache::cachePath(Utilities::PatternInfo const& info) const
+{
+  if (cache_dir_.isEmpty())
+  {
+    return QString();
+  }
+  auto const hash = contentHash(info.path_);
+  if (hash.isEmpty())
+  {
+    return QString();
+  }
+  return QStringLiteral("%1/%2_%3_v%4.png").arg(cache_dir_, QString::fromLatin1(hash))
+      .arg(c_thumbnail_pixels).arg(c_renderer_version);
+}
+
+} // View
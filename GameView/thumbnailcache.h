@@ -0,0 +1,49 @@
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QThreadPool>
+
+#include "../GameLogic/gamemodel.h"
+#include "../Utilities/rleparser.h"
+
+namespace View {
+
+// The recently used pattern thumbnails are kept in memory. A missing thumbnail is
+// loaded from the disk cache, keyed by the hash of the pattern file and the renderer
+// version, or rendered from the identity bitmap and saved there. Only the catalog
+// is kept, the cache never holds the game alive. Safe to call from any thread, the
+// caller is blocked while the pattern is parsed, so it's meant for the render pool only.
+class ThumbnailCache
+{
+public:
+  explicit ThumbnailCache(Utilities::PatternsPtr catalog);
+  ~ThumbnailCache();
+
+  ThumbnailCache(ThumbnailCache const&) = delete;
+  ThumbnailCache& operator = (ThumbnailCache const&) = delete;
+
+  // A null image for an unknown index.
+  QImage thumbnail(Logic::SizeT idx);
+  QThreadPool& pool()
+  {
+    return pool_;
+  }
+
+private:
+  QImage render(Logic::Pattern const& pattern) const;
+  QString cachePath(Utilities::PatternInfo const& info) const;
+
+  Utilities::PatternsPtr const catalog_;
+  QString const cache_dir_;
+  QThreadPool pool_;
+
+  QMutex mutex_;
+  QCache<Logic::SizeT, QImage> images_;
+};
+
+} // View
+
+#endif // THUMBNAILCACHE_H
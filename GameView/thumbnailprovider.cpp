@@ -0,0 +1,63 @@
+#include <atomic>
+
+#include <QRunnable>
+
+#include "thumbnailprovider.h"
+
+namespace View {
+
+namespace {
+
+// Deleted by the engine after finished(), never by the pool. A response cancelled
+// while queued, when its row is scrolled away, finishes without rendering.
+class ThumbnailResponse final : public QQuickImageResponse, public QRunnable
+{
+public:
+  ThumbnailResponse(QSharedPointer<ThumbnailCache> cache, Logic::SizeT idx)
+    : cache_(std::move(cache))
+    , idx_(idx)
+  {
+    setAutoDelete(false);
+  }
+
+  QQuickTextureFactory* textureFactory() const override
+  {
+    return QQuickTextureFactory::textureFactoryForImage(image_);
+  }
+  void cancel() override
+  {
+    cancelled_ = true;
+  }
+  void run() override
+  {
+    if (!cancelled_)
+    {
+      image_ = cache_->thumbnail(idx_);
+    }
+    emit finished();
+  }
+
+private:
+  QSharedPointer<ThumbnailCache> const cache_;
+  Logic::SizeT const idx_;
+  std::atomic<bool> cancelled_ { false };
+  QImage image_;
+};
+
+} // namespace
+
+ThumbnailProvider::ThumbnailProvider(QSharedPointer<ThumbnailCache> cache)
+  : cache_(std::move(cache))
+{}
+
+// Thumbnails have a single size, the image item scales them.
+QQuickImageResponse* ThumbnailProvider::requestImageResponse(QString const& id, QSize const&)
+{
+  auto ok = false;
+  auto const idx = id.toInt(&ok);
+  auto const response = new ThumbnailResponse(cache_, ok ? idx : -1);
+  cache_->pool().start(response);
+  return response;
+}
+
+} // View
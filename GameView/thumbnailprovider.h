@@ -0,0 +1,30 @@
+#ifndef THUMBNAILPROVIDER_H
+#define THUMBNAILPROVIDER_H
+
+#include <QQuickAsyncImageProvider>
+#include <QSharedPointer>
+
+#include "thumbnailcache.h"
+
+namespace View {
+
+constexpr char const* const c_thumbnail_provider = "patterns";
+
+// Serves "image://patterns/<catalog index>" from the thumbnail cache. Every request
+// is answered from the render pool, so the GUI thread never parses nor paints a
+// pattern. The cache is shared with the pending responses, the provider may be
+// replaced by the next game while they are still rendered.
+class ThumbnailProvider : public QQuickAsyncImageProvider
+{
+public:
+  explicit ThumbnailProvider(QSharedPointer<ThumbnailCache> cache);
+
+  QQuickImageResponse* requestImageResponse(QString const& id, QSize const& requested_size) override;
+
+private:
+  QSharedPointer<ThumbnailCache> const cache_;
+};
+
+} // View
+
+#endif // THUMBNAILPROVIDER_H
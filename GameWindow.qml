@@ -9,6 +9,7 @@ Page {
   width: parent.width
   height: parent.height
   title: qsTr("Scores: ") + gameView.scores
+         + (gameView.updateTime > 0 ? qsTr("  Step: ") + gameView.updateTime + qsTr(" ms") : "")
 
   states: [
     State {
@@ -27,6 +28,14 @@ Page {
       event.accepted = true
       gameView.stop()
       break
+    case Qt.Key_F:
+      event.accepted = true
+      gameView.runGenerations(event.modifiers & Qt.ShiftModifier ? 1000 : 100)
+      break
+    case Qt.Key_J:
+      event.accepted = true
+      jumpDialog.open()
+      break
     default:
       break
     }
@@ -174,7 +183,7 @@ Page {
     id: patternModel
 
     Item {
-      property var pattern: gameView.patternModelAt(index)
+      property int catalogIndex: patternIndex
       x: 5
       width: parent.width
       height: 40
@@ -183,30 +192,62 @@ Page {
         anchors.fill: parent
         onClicked: {
           parent.ListView.view.currentIndex = index
+          gameView.currentPattern = gameView.patternModelAt(catalogIndex)
         }
       }
+      Image {
+        id: thumbnail
+        source: "image://patterns/" + patternIndex
+        sourceSize: Qt.size(64, 64)
+        width: parent.height - 4
+        height: width
+        anchors.verticalCenter: parent.verticalCenter
+        fillMode: Image.PreserveAspectFit
+        asynchronous: true
+      }
       Column {
+        anchors.left: thumbnail.right
+        anchors.leftMargin: 5
         Row {
           Text {
-            text: pattern.name
+            text: name
             anchors.verticalCenter: parent.verticalCenter
             font.bold: true
           }
           Text {
-            text: "scores: " + pattern.scores
+            text: "scores: " + cells
             anchors.verticalCenter: parent.verticalCenter
           }
           spacing: 10
           anchors.horizontalCenter: parent.horizontalCenter
         }
         Text {
-          text: "size: " + pattern.size
+          text: "size: " + size.x + "x" + size.y
         }
         spacing: 10
       }
     }
   }
 
+  Popup {
+    id: jumpDialog
+    anchors.centerIn: parent
+    modal: true
+    focus: true
+
+    TextField {
+      id: jumpGeneration
+      focus: true
+      placeholderText: qsTr("Jump to generation")
+      validator: IntValidator { bottom: 0 }
+      onAccepted: {
+        gameView.jumpTo(Number(text))
+        jumpDialog.close()
+      }
+    }
+    onOpened: jumpGeneration.text = ""
+  }
+
   ListView {
     id: patternsList
     visible: false
@@ -218,15 +259,19 @@ Page {
     width: gameWindow.width
     height: gameWindow.height * 0.3
 
-    model: gameView.patternCount
+    model: gameView.patterns
     delegate: patternModel
-    highlight: Rectangle { color: "lightsteelblue"; radius: 5 }
-    currentIndex: -1
-    onCurrentItemChanged: {
-      if (currentIndex >= 0) {
-        gameView.currentPattern = currentItem.pattern
+    header: TextField {
+      width: patternsList.width
+      placeholderText: qsTr("Search patterns")
+      // Rows move while typing, the selection is only made by a click.
+      onTextChanged: {
+        patternsList.currentIndex = -1
+        gameView.patterns.text = text
       }
     }
+    highlight: Rectangle { color: "lightsteelblue"; radius: 5 }
+    currentIndex: -1
 
     function show() {
       visible = true
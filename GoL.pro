@@ -16,12 +16,26 @@ DEFINES += QT_DEPRECATED_WARNINGS
 SOURCES += main.cpp \
     GameView/gameview.cpp \
     GameView/mainwindow.cpp \
+    GameView/patternlistmodel.cpp \
+    GameView/thumbnailcache.cpp \
+    GameView/thumbnailprovider.cpp \
     Utilities/rleparser.cpp \
+    Utilities/patternpack.cpp \
+    Utilities/rlereader.cpp \
+    Utilities/mappedfile.cpp \
+    Utilities/patternlibrary.cpp \
+    Utilities/macrocell.cpp \
+    Utilities/patternindex.cpp \
     GameLogic/gamemodel.cpp \
     GameLogic/src/cpulifeprocessor.cpp \
     Network/src/steamnetwork.cpp \
     GameLogic/gamecontroller.cpp \
-    GameLogic/src/lifeprocessor.cpp
+    GameLogic/src/lifeprocessor.cpp \
+    GameLogic/src/lifeunitsindex.cpp \
+    GameLogic/src/densitypyramid.cpp \
+    GameLogic/src/enginethreadpool.cpp \
+    GameLogic/src/fieldbuffer.cpp \
+    GameLogic/src/fieldwriter.cpp
 
 RESOURCES += qml.qrc \
              patterns.qrc
@@ -40,14 +54,30 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 HEADERS += \
     GameView/gameview.h \
     GameView/mainwindow.h \
+    GameView/patternlistmodel.h \
+    GameView/thumbnailcache.h \
+    GameView/thumbnailprovider.h \
     Utilities/rleparser.h \
+    Utilities/patternpack.h \
+    Utilities/rlereader.h \
+    Utilities/mappedfile.h \
+    Utilities/patternlibrary.h \
+    Utilities/macrocell.h \
+    Utilities/patternindex.h \
     Utilities/qtutilities.h \
+    Utilities/mpscring.h \
     GameLogic/gamecontroller.h \
     GameLogic/gamemodel.h \
     GameLogic/src/patterns.h \
     Network/gamenetwork.h \
     Network/src/steamnetwork.h \
-    GameLogic/src/lifeprocessor.h
+    GameLogic/src/lifeprocessor.h \
+    GameLogic/src/lifeunitsindex.h \
+    GameLogic/src/densitypyramid.h \
+    GameLogic/src/lifesnapshot.h \
+    GameLogic/src/enginethreadpool.h \
+    GameLogic/src/fieldbuffer.h \
+    GameLogic/src/fieldwriter.h
 
 macx|ios {
     QMAKE_OBJECTIVE_CFLAGS += -fobjc-arc
@@ -60,6 +90,28 @@ else: unix|win32 {
     SOURCES += GameLogic/src/opencllifeprocessor.cpp
 }
 
+# Patterns/*.rle packed into one binary file next to the executable,
+# the game parses the RLE resources when it is missing. Patterns/metadata.tsv is
+# regenerated offline by Utilities/characterizepatterns.py Patterns Patterns/metadata.tsv
+PATTERN_PACK = $$OUT_PWD/patterns.pack
+pattern_pack.target = $$PATTERN_PACK
+pattern_pack.depends = $$PWD/Utilities/packpatterns.py $$PWD/Patterns/metadata.tsv $$files($$PWD/Patterns/*.rle)
+pattern_pack.commands = python3 $$PWD/Utilities/packpatterns.py $$PWD/Patterns $$PATTERN_PACK
+QMAKE_EXTRA_TARGETS += pattern_pack
+PRE_TARGETDEPS += $$PATTERN_PACK
+
+macx {
+    patternPack.files = $$PATTERN_PACK
+    patternPack.path = Contents/Resources
+    QMAKE_BUNDLE_DATA += patternPack
+}
+else: !isEmpty(target.path) {
+    patternPack.files = $$PATTERN_PACK
+    patternPack.path = $$target.path
+    patternPack.CONFIG += no_check_exist
+    INSTALLS += patternPack
+}
+
 steamLib.files = $$PWD/redistributable_bin/osx32/
 steamLib.path = Contents/MacOS/
 QMAKE_BUNDLE_DATA += steamLib
@@ -0,0 +1,289 @@
+#!/usr/bin/env python3
+"""Runs every pattern of Patterns/*.rle alone on an unbounded board and records how
+it behaves, the pattern pack carries the results as catalog metadata.
+
+Every pattern is simulated in its own process until its cells repeat up to a shift,
+it dies, or the generation or population limit is hit. Gliders escaping from the
+pattern are stripped from the board once nothing can catch them, so methuselahs
+settle into their ash and guns repeat; their cells still count in the population.
+Columns of the output, tab separated with a header line:
+  file            RLE file name
+  growth          dies, still, oscillates, moves, grows, chaotic or unknown
+  period          generations of the cycle, 0 when there is none
+  dx, dy          shift of the cells per cycle, rows counted from the top
+  stabilization   first generation of the cycle or of the death, -1 when it never stabilized
+  min, max        population range over the simulated generations
+  curve           population sampled at 16 evenly spaced generations
+
+A pattern repeating while it emits gliders is a gun and grows, one that never
+repeats grows when its population keeps increasing over the second half of the
+run and is chaotic otherwise.
+"""
+
+import argparse
+import multiprocessing
+import os
+import sys
+from collections import Counter
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from packpatterns import read_pattern  # noqa: E402
+
+COLUMNS = ("file", "growth", "period", "dx", "dy", "stabilization", "min", "max", "curve")
+NEIGHBOURS = tuple((dx, dy) for dy in (-1, 0, 1) for dx in (-1, 0, 1) if dx or dy)
+CURVE_SAMPLES = 16
+NEVER_STABILIZED = -1
+# Rows are Python integers, bit n is the column base + n. The board is shifted by
+# a whole word when a cell reaches bit 0, so births on its left have room.
+BASE_SHIFT = 64
+# Free cells around an escaping glider, any closer cell may still hit it.
+GLIDER_CLEARANCE = 3
+# Over the second half of the run, split into windows.
+TREND_WINDOWS = 3
+TREND_GROWTH = 1.2
+
+
+def step_cells(cells):
+    counts = Counter((x + dx, y + dy) for x, y in cells for dx, dy in NEIGHBOURS)
+    return {cell for cell, count in counts.items() if count == 3 or (count == 2 and cell in cells)}
+
+
+def normalized(cells):
+    left = min(x for x, _ in cells)
+    top = min(y for _, y in cells)
+    return frozenset((x - left, y - top) for x, y in cells)
+
+
+def glider_shapes():
+    """Every phase of the glider in the four directions, by its shift per 4 generations."""
+    shapes = {}
+    for mirror_x in (1, -1):
+        for mirror_y in (1, -1):
+            cells = {(mirror_x * x, mirror_y * y) for x, y in ((1, 0), (2, 1), (0, 2), (1, 2), (2, 2))}
+            for _ in range(4):
+                shapes[normalized(cells)] = (mirror_x, mirror_y)
+                cells = step_cells(cells)
+    return shapes
+
+
+GLIDERS = glider_shapes()
+
+
+def popcount(bits):
+    return bin(bits).count("1")
+
+
+def step(rows):
+    """Next generation of the rows, eight shifted neighbour rows summed a bit plane at a time."""
+    result = {}
+    candidates = set()
+    for y in rows:
+        candidates.update((y - 1, y, y + 1))
+    for y in candidates:
+        above = rows.get(y - 1, 0)
+        row = rows.get(y, 0)
+        below = rows.get(y + 1, 0)
+        ones = twos = fours = eights = 0
+        for neighbours in (above << 1, above, above >> 1, row << 1, row >> 1, below << 1, below, below >> 1):
+            carry = ones & neighbours
+            ones ^= neighbours
+            carry, twos = twos & carry, twos ^ carry
+            carry, fours = fours & carry, fours ^ carry
+            eights |= carry
+        alive = twos & ~fours & ~eights & (ones | row)
+        if alive:
+            result[y] = alive
+    return result
+
+
+class Board:
+    def __init__(self, words):
+        self.base = -BASE_SHIFT
+        self.rows = {}
+        for row, column, bits in words:
+            self.rows[row] = self.rows.get(row, 0) | bits << (column - self.base)
+        self.rows = {y: bits for y, bits in self.rows.items() if bits}
+
+    def population(self):
+        return sum(popcount(bits) for bits in self.rows.values())
+
+    def step(self):
+        if any(bits & 1 for bits in self.rows.values()):
+            self.rows = {y: bits << BASE_SHIFT for y, bits in self.rows.items()}
+            self.base -= BASE_SHIFT
+        self.rows = step(self.rows)
+
+    def bounds(self):
+        """left, top, right, bottom of the live cells."""
+        columns = 0
+        for bits in self.rows.values():
+            columns |= bits
+        return ((columns & -columns).bit_length() - 1 + self.base, min(self.rows),
+                columns.bit_length() - 1 + self.base, max(self.rows))
+
+    def shape(self):
+        """Hash of the cells moved to the origin and the shift that does it."""
+        left, top, _, _ = self.bounds()
+        shift = left - self.base
+        return hash(tuple((y - top, bits >> shift) for y, bits in sorted(self.rows.items()))), left, top
+
+    def cells_in(self, left, top, right, bottom):
+        mask = (1 << (right - left + 1)) - 1
+        cells = set()
+        for y in range(top, bottom + 1):
+            bits = self.rows.get(y, 0) >> (left - self.base) & mask if left >= self.base else 0
+            for x in range(right - left + 1):
+                if bits >> x & 1:
+                    cells.add((left + x, y))
+        return cells
+
+    def count_in(self, left, top, right, bottom):
+        left = max(left, self.base)
+        if right < left:
+            return 0
+        mask = (1 << (right - left + 1)) - 1
+        return sum(popcount(self.rows.get(y, 0) >> (left - self.base) & mask) for y in range(top, bottom + 1))
+
+    def remove(self, cells):
+        for x, y in cells:
+            self.rows[y] &= ~(1 << (x - self.base))
+            if not self.rows[y]:
+                del self.rows[y]
+
+    def edge_boxes(self):
+        """3x3 boxes touching a side of the bounds, where an escaping glider would be."""
+        left, top, right, bottom = self.bounds()
+        for y, side in ((top, (0, -1)), (bottom - 2, (0, 1))):
+            columns = 0
+            for row in range(y, y + 3):
+                columns |= self.rows.get(row, 0)
+            for x in runs_of(columns, 3):
+                yield (x + self.base, y, x + self.base + 2, y + 2), side
+        for x, side in ((left, (-1, 0)), (right - 2, (1, 0))):
+            rows = 0
+            for y in self.rows:
+                if self.count_in(x, y, x + 2, y):
+                    rows |= 1 << (y - top)
+            for y in runs_of(rows, 3):
+                yield (x, y + top, x + 2, y + top + 2), side
+
+    def strip_gliders(self):
+        """Removes the gliders leaving the bounds with no cell near them, returns their cells."""
+        if len(self.rows) < 3:
+            return 0
+        stripped = 0
+        for box, side in list(self.edge_boxes()):
+            left, top, right, bottom = box
+            cells = self.cells_in(left, top, right, bottom)
+            direction = GLIDERS.get(normalized(cells)) if len(cells) == 5 else None
+            if direction is None or (side[0] and direction[0] != side[0]) or (side[1] and direction[1] != side[1]):
+                continue
+            clearance = GLIDER_CLEARANCE
+            if self.count_in(left - clearance, top - clearance, right + clearance, bottom + clearance) != len(cells):
+                continue
+            if len(cells) == self.population():
+                break
+            self.remove(cells)
+            stripped += len(cells)
+        return stripped
+
+
+def runs_of(bits, length):
+    """First bits of the runs of exactly length set bits."""
+    position = 0
+    while bits:
+        skip = (bits & -bits).bit_length() - 1
+        bits >>= skip
+        position += skip
+        run = (~bits & (bits + 1)).bit_length() - 1
+        if run == length:
+            yield position
+        bits >>= run
+        position += run
+
+
+def growing(populations):
+    """The population keeps increasing over the second half."""
+    half = populations[len(populations) // 2:]
+    if len(half) < TREND_WINDOWS:
+        return populations[-1] >= TREND_GROWTH * populations[0]
+    size = len(half) // TREND_WINDOWS
+    means = [sum(half[index * size:(index + 1) * size]) / size for index in range(TREND_WINDOWS)]
+    return all(lhs <= rhs for lhs, rhs in zip(means, means[1:])) and means[-1] >= TREND_GROWTH * means[0]
+
+
+def characterize(task):
+    path, generations, max_population, max_cells = task
+    result = dict(file=os.path.basename(path), growth="unknown", period=0, dx=0, dy=0,
+                  stabilization=NEVER_STABILIZED, min=0, max=0, curve="")
+    try:
+        _, _, _, initial_cells, words = read_pattern(path)
+    except (OSError, ValueError):
+        return result
+    if initial_cells > max_cells:
+        result.update(min=initial_cells, max=initial_cells)
+        return result
+
+    board = Board(words)
+    seen = {}
+    strips = []
+    escaped = 0
+    populations = []
+    for generation in range(generations + 1):
+        stripped = board.strip_gliders() if board.rows else 0
+        if stripped:
+            escaped += stripped
+            strips.append(generation)
+        population = board.population()
+        populations.append(population + escaped)
+        if population == 0:
+            result.update(growth="dies", stabilization=generation)
+            break
+        key, left, top = board.shape()
+        if key in seen:
+            first, first_left, first_top = seen[key]
+            dx, dy = left - first_left, top - first_top
+            period = generation - first
+            if any(first < strip <= generation for strip in strips):
+                growth = "grows"
+            else:
+                growth = "moves" if dx or dy else ("still" if period == 1 else "oscillates")
+            result.update(growth=growth, period=period, dx=dx, dy=dy, stabilization=first)
+            break
+        seen[key] = (generation, left, top)
+        if population > max_population or generation == generations:
+            result["growth"] = "grows" if growing(populations) else "chaotic"
+            break
+        board.step()
+
+    samples = [populations[index * (len(populations) - 1) // (CURVE_SAMPLES - 1)] for index in range(CURVE_SAMPLES)]
+    result.update(min=min(populations), max=max(populations), curve=",".join(map(str, samples)))
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("patterns_dir")
+    parser.add_argument("output")
+    parser.add_argument("--generations", type=int, default=6000)
+    parser.add_argument("--max-population", type=int, default=20000)
+    parser.add_argument("--max-cells", type=int, default=20000, help="larger patterns are not simulated")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count())
+    parser.add_argument("files", nargs="*", help="only these files, all of them by default")
+    args = parser.parse_args()
+
+    files = args.files or sorted((entry for entry in os.listdir(args.patterns_dir) if entry.endswith(".rle")),
+                                 key=str.lower)
+    tasks = [(os.path.join(args.patterns_dir, entry), args.generations, args.max_population, args.max_cells)
+             for entry in files]
+    with multiprocessing.Pool(args.jobs) as pool:
+        results = pool.map(characterize, tasks, chunksize=1)
+
+    with open(args.output, "w", encoding="utf-8", newline="\n") as output:
+        output.write("\t".join(COLUMNS) + "\n")
+        for result in results:
+            output.write("\t".join(str(result[column]) for column in COLUMNS) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#include <QDebug>
+
+#include "macrocell.h"
+#include "rleparser.h"
+#include "qtutilities.h"
+
+namespace Utilities {
+
+namespace {
+
+constexpr char const c_macrocell_magic[] = "[M2]";
+constexpr int const c_leaf_level = 3;
+constexpr int const c_leaf_size = 1 << c_leaf_level;
+// Coordinates of deeper trees don't fit into int.
+constexpr int const c_max_level = 30;
+// Bigger patterns have no points, they are placed by their bitmaps only.
+constexpr uint64_t const c_max_points = 1 << 24;
+
+quint64 leafKey(quint32 x, quint32 y)
+{
+  return static_cast<quint64>(y) << 32 | x;
+}
+
+bool readNumber(char const*& position, char const* end, uint32_t& number)
+{
+  while (position != end && *position == ' ')
+  {
+    ++position;
+  }
+  if (position == end || *position < '0' || *position > '9')
+  {
+    return false;
+  }
+  number = 0;
+  for (; position != end && *position >= '0' && *position <= '9'; ++position)
+  {
+    number = number * 10 + static_cast<uint32_t>(*position - '0');
+  }
+  return true;
+}
+
+QRect bitsBounds(uint64_t bits)
+{
+  QRect bounds;
+  for (; bits != 0; bits &= bits - 1)
+  {
+    auto const bit = static_cast<int>(qCountTrailingZeroBits(bits));
+    bounds |= QRect(bit % c_leaf_size, bit / c_leaf_size, 1, 1);
+  }
+  return bounds;
+}
+
+QByteArray leafLine(uint64_t bits)
+{
+  QByteArray line;
+  for (int y = 0; y < c_leaf_size && (bits >> (y * c_leaf_size)) != 0; ++y)
+  {
+    for (auto row = static_cast<uint32_t>(bits >> (y * c_leaf_size)) & 0xff; row != 0; row >>= 1)
+    {
+      line.append((row & 1) ? '*' : '.');
+    }
+    line.append('$');
+  }
+  return line;
+}
+
+// The bitmaps are packed straight from the leaves and the other variants
+// transformed from its words. The points are expanded on the first request
+// only, and never for the patterns above c_max_points.
+class MacrocellPattern final : public Logic::Pattern
+{
+public:
+  explicit MacrocellPattern(QString name, Macrocell macrocell)
+    : macrocell_(std::move(macrocell))
+    , name_(macrocell_.name().isEmpty() ? std::move(name) : macrocell_.name())
+    , size_(macrocell_.bounds().width(), macrocell_.bounds().height())
+  {
+    Q_ASSERT(macrocell_.isValid());
+  }
+
+  QString name() const override
+  {
+    return name_;
+  }
+  Logic::Points const& points() const override
+  {
+    std::call_once(points_read_, [this]
+    {
+      if (macrocell_.cells() > c_max_points)
+      {
+        qDebug() << "No points for" << name_ << ":" << macrocell_.cells() << "cells";
+        return;
+      }
+      points_.reserve(static_cast<int>(macrocell_.cells()));
+      auto const size = size_;
+      auto& points = points_;
+      macrocell_.readRuns([size, &points](int x, int y, int length)
+      {
+        for (auto const end = x + length; x < end; ++x)
+        {
+          points.push_back(QPoint(x, size.y() - y - 1) - size / 2);
+        }
+      });
+    });
+    return points_;
+  }
+  QPoint size() const override
+  {
+    return size_;
+  }
+  Logic::Score scores() const override
+  {
+    return static_cast<Logic::Score>(macrocell_.cells());
+  }
+  Logic::PatternBitmap const& bitmap(Logic::PatternVariant variant) const override
+  {
+    Q_ASSERT(variant < Logic::c_pattern_variants);
+    std::call_once(bitmaps_built_[variant], [this, variant]
+    {
+      if (variant != 0)
+      {
+        bitmaps_[variant] = Logic::transformPatternBitmap(bitmap(0), variant);
+        return;
+      }
+      PatternBitmapWriter writer(size_, QRect(QPoint(), QSize(size_.x(), size_.y())));
+      macrocell_.readRuns([&writer](int x, int y, int length)
+      {
+        writer.addRun(x, y, length);
+      });
+      bitmaps_[0] = writer.finish();
+    });
+    return bitmaps_[variant];
+  }
+
+private:
+  Macrocell const macrocell_;
+  QString const name_;
+  QPoint const size_;
+
+  mutable std::once_flag points_read_;
+  mutable Logic::Points points_;
+  mutable std::array<std::once_flag, Logic::c_pattern_variants> bitmaps_built_;
+  mutable std::array<Logic::PatternBitmap, Logic::c_pattern_variants> bitmaps_;
+};
+
+} // namespace
+
+Macrocell::Macrocell(QByteArray const& bytes)
+  : nodes_(1)
+{
+  auto const* position = bytes.constData();
+  auto const* const end = position + bytes.size();
+  auto has_magic = false;
+  while (position != end)
+  {
+    auto const* line_end = std::find(position, end, '\n');
+    auto const* const line = position;
+    position = (line_end == end) ? end : line_end + 1;
+    while (line_end != line && (line_end[-1] == '\r' || line_end[-1] == ' '))
+    {
+      --line_end;
+    }
+    if (line_end == line)
+    {
+      continue;
+    }
+
+    if (!has_magic)
+    {
+      has_magic = (line_end - line >= 4 && std::strncmp(line, c_macrocell_magic, 4) == 0);
+      if (!has_magic)
+      {
+        return;
+      }
+    }
+    else if (*line == '#')
+    {
+      auto const type = (line_end - line > 1) ? line[1] : '\0';
+      auto const* value = std::min(line + 2, line_end);
+      while (value != line_end && *value == ' ')
+      {
+        ++value;
+      }
+      if (type == 'R')
+      {
+        rule_ = QString::fromUtf8(value, static_cast<int>(line_end - value));
+      }
+      else if (type == 'N')
+      {
+        name_ = QString::fromUtf8(value, static_cast<int>(line_end - value));
+      }
+    }
+    else if (!readNode(line, line_end))
+    {
+      return;
+    }
+  }
+  valid_ = has_magic && nodes_.size() > 1;
+  root_ = valid_ ? static_cast<uint32_t>(nodes_.size() - 1) : 0;
+}
+
+// A leaf is "$"-separated rows of '.' and '*', any other node is
+// "level nw ne sw se" with the children by their line numbers.
+bool Macrocell::readNode(char const* begin, char const* end)
+{
+  Node node;
+  if (*begin == '.' || *begin == '*' || *begin == '$')
+  {
+    node.level_ = c_leaf_level;
+    int x = 0;
+    int y = 0;
+    for (auto const* position = begin; position != end; ++position)
+    {
+      if (*position == '$')
+      {
+        x = 0;
+        ++y;
+        continue;
+      }
+      if (x >= c_leaf_size || y >= c_leaf_size || (*position != '.' && *position != '*'))
+      {
+        return false;
+      }
+      if (*position == '*')
+      {
+        node.bits_ |= uint64_t(1) << (x + y * c_leaf_size);
+      }
+      ++x;
+    }
+  }
+  else
+  {
+    uint32_t level = 0;
+    auto const* position = begin;
+    if (!readNumber(position, end, level) || level < 1 || level > c_max_level)
+    {
+      return false;
+    }
+    node.level_ = static_cast<int>(level);
+    for (auto& child : node.children_)
+    {
+      if (!readNumber(position, end, child))
+      {
+        return false;
+      }
+    }
+
+    auto const half = 1 << (node.level_ - 1);
+    for (int idx = 0; idx < 4; ++idx)
+    {
+      auto const child = node.children_[idx];
+      auto const shift = (idx & 1) * half + (idx >> 1) * half * c_leaf_size;
+      if (node.level_ == 1)
+      {
+        // Cell states of multi-state rules, every state but 0 is alive.
+        node.bits_ |= (child != 0) ? (uint64_t(1) << shift) : 0;
+        continue;
+      }
+      if (child >= nodes_.size() || (child != 0 && nodes_[child].level_ != node.level_ - 1))
+      {
+        return false;
+      }
+      if (node.level_ <= c_leaf_level)
+      {
+        node.bits_ |= nodes_[child].bits_ << shift;
+      }
+    }
+  }
+
+  if (node.level_ <= c_leaf_level)
+  {
+    node.cells_ = qPopulationCount(node.bits_);
+    node.bounds_ = bitsBounds(node.bits_);
+  }
+  else
+  {
+    auto const half = 1 << (node.level_ - 1);
+    for (int idx = 0; idx < 4; ++idx)
+    {
+      auto const& child = nodes_[node.children_[idx]];
+      if (child.cells_ > 0)
+      {
+        node.cells_ += child.cells_;
+        node.bounds_ |= child.bounds_.translated((idx & 1) * half, (idx >> 1) * half);
+      }
+    }
+  }
+  nodes_.push_back(node);
+  return true;
+}
+
+// Leaves of the band left to right. A band is as tall as a leaf and lies in either
+// the north or the south half of every bigger node.
+void Macrocell::collectLeaves(uint32_t node, QPoint position, int band, std::vector<Leaf>& leaves) const
+{
+  auto const& current = nodes_[node];
+  if (current.cells_ == 0)
+  {
+    return;
+  }
+  if (current.level_ <= c_leaf_level)
+  {
+    leaves.push_back(Leaf(position.x(), current.bits_));
+    return;
+  }
+  auto const half = 1 << (current.level_ - 1);
+  for (int idx = 0; idx < 4; ++idx)
+  {
+    auto const child_position = position + QPoint((idx & 1) * half, (idx >> 1) * half);
+    if (band >= child_position.y() && band < child_position.y() + half)
+    {
+      collectLeaves(current.children_[idx], child_position, band, leaves);
+    }
+  }
+}
+
+void MacrocellWriter::addRun(int x, int y, int length)
+{
+  Q_ASSERT(x >= 0 && y >= 0 && length > 0);
+  size_ = QPoint(std::max(size_.x(), x + length), std::max(size_.y(), y + 1));
+  auto const row_shift = (y % c_leaf_size) * c_leaf_size;
+  while (length > 0)
+  {
+    auto const offset = x % c_leaf_size;
+    auto const count = std::min(length, c_leaf_size - offset);
+    auto const bits = ((uint64_t(1) << count) - 1) << offset;
+    leaves_[leafKey(static_cast<quint32>(x / c_leaf_size), static_cast<quint32>(y / c_leaf_size))] |= bits << row_shift;
+    x += count;
+    length -= count;
+  }
+}
+
+// Nodes are merged level by level from the leaves up to the root, which is
+// the last line as the format requires.
+QByteArray MacrocellWriter::write(QString const& name, QString const& rule) const
+{
+  QByteArray result = QByteArray(c_macrocell_magic) + " (GoL)\n#R " + rule.toUtf8() + "\n";
+  if (!name.isEmpty())
+  {
+    result += "#N " + name.toUtf8() + "\n";
+  }
+
+  uint32_t node_count = 0;
+  std::map<quint64, uint32_t> level_nodes;
+  std::map<uint64_t, uint32_t> leaf_ids;
+  std::map<quint64, quint64> leaves;
+  for (auto leaf = leaves_.begin(); leaf != leaves_.end(); ++leaf)
+  {
+    leaves.emplace(leaf.key(), leaf.value());
+  }
+  for (auto const& leaf : leaves)
+  {
+    auto& id = leaf_ids[leaf.second];
+    if (id == 0)
+    {
+      id = ++node_count;
+      result += leafLine(leaf.second) + "\n";
+    }
+    level_nodes[leaf.first] = id;
+  }
+  if (level_nodes.empty())
+  {
+    return result + "$\n";
+  }
+
+  int root_level = c_leaf_level;
+  while ((1 << root_level) < std::max(size_.x(), size_.y()))
+  {
+    ++root_level;
+  }
+  for (int level = c_leaf_level + 1; level <= root_level; ++level)
+  {
+    std::map<quint64, std::array<uint32_t, 4>> parents;
+    for (auto const& node : level_nodes)
+    {
+      auto const x = static_cast<quint32>(node.first);
+      auto const y = static_cast<quint32>(node.first >> 32);
+      parents[leafKey(x / 2, y / 2)][(x & 1) + 2 * (y & 1)] = node.second;
+    }
+    level_nodes.clear();
+
+    std::map<std::array<uint32_t, 4>, uint32_t> node_ids;
+    for (auto const& parent : parents)
+    {
+      auto& id = node_ids[parent.second];
+      if (id == 0)
+      {
+        id = ++node_count;
+        result += QByteArray::number(level);
+        for (auto const child : parent.second)
+        {
+          result += ' ' + QByteArray::number(child);
+        }
+        result += '\n';
+      }
+      level_nodes[parent.first] = id;
+    }
+  }
+  Q_ASSERT(level_nodes.size() == 1 && level_nodes.begin()->first == 0);
+  return result;
+}
+
+Logic::PatternPtr createMacrocellPattern(QString name, QByteArray const& bytes)
+{
+  Macrocell macrocell(bytes);
+  if (!macrocell.isValid() || macrocell.cells() == 0)
+  {
+    return nullptr;
+  }
+  return Qt::makeShared<MacrocellPattern>(std::move(name), std::move(macrocell));
+}
+
+bool isMacrocell(QByteArray const& bytes)
+{
+  return bytes.startsWith(c_macrocell_magic);
+}
+
+} // Utilities
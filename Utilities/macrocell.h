@@ -0,0 +1,126 @@
+#ifndef MACROCELL_H
+#define MACROCELL_H
+
+#include <cstdint>
+#include <vector>
+
+#include <QByteArray>
+#include <QHash>
+#include <QPair>
+#include <QRect>
+#include <QString>
+
+#include "../GameLogic/gamemodel.h"
+
+namespace Utilities {
+
+// Hashed quadtree read from a Macrocell file. Nodes are stored children first as in
+// the file, node 0 is the empty node of any level. Nodes up to 8x8 cells keep their
+// cells as a bitmap, so the tree is expanded a leaf row at a time.
+class Macrocell
+{
+public:
+  // Rows of "[M2]" bytes, isValid() is false when they are malformed.
+  explicit Macrocell(QByteArray const& bytes);
+
+  bool isValid() const
+  {
+    return valid_;
+  }
+  QString const& name() const
+  {
+    return name_;
+  }
+  QString const& rule() const
+  {
+    return rule_;
+  }
+  // Live cells with rows counted from the top of the root node.
+  QRect bounds() const
+  {
+    return nodes_[root_].bounds_;
+  }
+  uint64_t cells() const
+  {
+    return nodes_[root_].cells_;
+  }
+
+  // Calls visitor(x, y, length) for every run of live cells relative to bounds(),
+  // a row at a time with growing columns. Only the leaves of 8 rows are expanded
+  // at once, whatever the size of the pattern.
+  template<typename RunVisitor>
+  void readRuns(RunVisitor&& visitor) const;
+
+private:
+  struct Node
+  {
+    int level_ = 0;
+    uint32_t children_[4] = {};
+    // Cells of the nodes up to level 3, bit x + 8 * y.
+    uint64_t bits_ = 0;
+    uint64_t cells_ = 0;
+    QRect bounds_;
+  };
+  using Leaf = QPair<int, uint64_t>;
+
+  bool readNode(char const* begin, char const* end);
+  void collectLeaves(uint32_t node, QPoint position, int band, std::vector<Leaf>& leaves) const;
+
+  bool valid_ = false;
+  QString name_;
+  QString rule_;
+  std::vector<Node> nodes_;
+  uint32_t root_ = 0;
+};
+
+template<typename RunVisitor>
+void Macrocell::readRuns(RunVisitor&& visitor) const
+{
+  constexpr int const c_leaf_size = 8;
+  if (cells() == 0)
+  {
+    return;
+  }
+  auto const bounds = this->bounds();
+  std::vector<Leaf> leaves;
+  for (auto band = bounds.top() - bounds.top() % c_leaf_size; band <= bounds.bottom(); band += c_leaf_size)
+  {
+    leaves.clear();
+    collectLeaves(root_, QPoint(), band, leaves);
+    for (int row = 0; row < c_leaf_size; ++row)
+    {
+      for (auto const& leaf : leaves)
+      {
+        for (auto bits = static_cast<uint32_t>(leaf.second >> (row * c_leaf_size)) & 0xff; bits != 0;)
+        {
+          auto const start = static_cast<int>(qCountTrailingZeroBits(bits));
+          auto const length = static_cast<int>(qCountTrailingZeroBits(~(bits >> start)));
+          visitor(leaf.first + start - bounds.left(), band + row - bounds.top(), length);
+          bits &= ~(((1u << length) - 1) << start);
+        }
+      }
+    }
+  }
+}
+
+// Builds the hashed quadtree of the live runs, equal nodes are written once.
+class MacrocellWriter
+{
+public:
+  // Rows are counted from the top, both coordinates from 0.
+  void addRun(int x, int y, int length);
+  QByteArray write(QString const& name, QString const& rule = "B3/S23") const;
+
+private:
+  // Leaves of 8x8 cells by (y << 32 | x) in leaf units.
+  QHash<quint64, quint64> leaves_;
+  QPoint size_;
+};
+
+// Reads Macrocell bytes into a pattern, name is used when the file has none.
+Logic::PatternPtr createMacrocellPattern(QString name, QByteArray const& bytes);
+bool isMacrocell(QByteArray const& bytes);
+
+} // Utilities
+
+#endif // MACROCELL_H
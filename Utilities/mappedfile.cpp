@@ -0,0 +1,58 @@
+#include <limits>
+
+#include <QtGlobal>
+
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mappedfile.h"
+
+namespace Utilities {
+
+MappedFile::MappedFile(QString const& path)
+#if !defined(Q_OS_UNIX)
+  : file_(path)
+#endif
+{
+#if defined(Q_OS_UNIX)
+  auto const descriptor = open(QFile::encodeName(path).constData(), O_RDONLY);
+  if (descriptor < 0)
+  {
+    return;
+  }
+  struct stat status;
+  if (fstat(descriptor, &status) == 0 && status.st_size > 0
+      && status.st_size <= std::numeric_limits<int>::max())
+  {
+    auto* const mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (mapping != MAP_FAILED)
+    {
+      data_ = static_cast<char const*>(mapping);
+      size_ = status.st_size;
+    }
+  }
+  close(descriptor);
+#else
+  if (file_.open(QIODevice::ReadOnly) && file_.size() > 0 && file_.size() <= std::numeric_limits<int>::max())
+  {
+    size_ = file_.size();
+    data_ = reinterpret_cast<char const*>(file_.map(0, size_));
+  }
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(Q_OS_UNIX)
+  if (data_ != nullptr)
+  {
+    munmap(const_cast<char*>(data_), static_cast<size_t>(size_));
+  }
+#endif
+}
+
+} // Utilities
@@ -0,0 +1,42 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+namespace Utilities {
+
+// Read-only mapping of a whole file. Pages are read on the first access and
+// dropped by the system under memory pressure. On Unix the file is closed right
+// after mapping, so thousands of mapped patterns don't use up descriptors.
+class MappedFile
+{
+public:
+  explicit MappedFile(QString const& path);
+  ~MappedFile();
+
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator = (MappedFile const&) = delete;
+
+  bool isValid() const
+  {
+    return data_ != nullptr;
+  }
+  // Valid while the mapped file is alive.
+  QByteArray bytes() const
+  {
+    return QByteArray::fromRawData(data_, static_cast<int>(size_));
+  }
+
+private:
+  char const* data_ = nullptr;
+  qint64 size_ = 0;
+#if !defined(Q_OS_UNIX)
+  QFile file_;
+#endif
+};
+
+} // Utilities
+
+#endif // MAPPEDFILE_H
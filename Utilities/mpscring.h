@@ -0,0 +1,90 @@
+#ifndef MPSCRING_H
+#define MPSCRING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Utilities {
+
+// Bounded multiple producer, single consumer queue without locks. Every cell carries
+// a sequence number telling whether it is free for the producer of that position
+// or holds a value for the consumer.
+template<typename T, size_t Capacity>
+class MpscRing
+{
+  static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+  static constexpr size_t const c_mask = Capacity - 1;
+
+public:
+  MpscRing()
+  {
+    for (size_t idx = 0; idx < Capacity; ++idx)
+    {
+      cells_[idx].sequence_.store(idx, std::memory_order_relaxed);
+    }
+  }
+
+  MpscRing(MpscRing const&) = delete;
+  MpscRing& operator = (MpscRing const&) = delete;
+
+  // Any thread. Returns false when the ring is full.
+  bool push(T value)
+  {
+    auto position = tail_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      auto& cell = cells_[position & c_mask];
+      auto const sequence = cell.sequence_.load(std::memory_order_acquire);
+      auto const difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (difference == 0)
+      {
+        if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        {
+          cell.value_ = std::move(value);
+          cell.sequence_.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (difference < 0)
+      {
+        return false;
+      }
+      else
+      {
+        position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // The consumer thread only.
+  bool pop(T& value)
+  {
+    auto& cell = cells_[head_ & c_mask];
+    if (cell.sequence_.load(std::memory_order_acquire) != head_ + 1)
+    {
+      return false;
+    }
+    value = std::move(cell.value_);
+    cell.value_ = T();
+    cell.sequence_.store(head_ + Capacity, std::memory_order_release);
+    ++head_;
+    return true;
+  }
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence_ { 0 };
+    T value_ {};
+  };
+
+  std::array<Cell, Capacity> cells_;
+  alignas(64) std::atomic<size_t> tail_ { 0 };
+  alignas(64) size_t head_ = 0;
+};
+
+} // Utilities
+
+#endif // MPSCRING_H
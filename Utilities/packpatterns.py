@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""Packs Patterns/*.rle into the binary pattern pack read by Utilities/patternpack.cpp.
+
+Layout, little-endian:
+  header   magic "GoLP", u32 version, u32 pattern count
+  index    per pattern: u32 name offset, u32 name size, u32 file offset, u32 file size,
+           i32 width, i32 height, u32 cells, u32 words offset, u32 word count,
+           u32 growth, u32 period, i32 dx, i32 dy, u32 stabilization, u32 min population,
+           u32 max population, 16 x u32 population curve
+  strings  UTF-8 names and file names
+  words    8-byte aligned, per pattern the words holding live cells in RLE order:
+           u32 row from the top, u32 first column, u64 cells with bit n at column + n
+
+The behaviour columns come from metadata.tsv in the patterns directory, written by
+characterizepatterns.py, and are zero for the patterns it doesn't list. A pattern
+that never stabilized has 0xFFFFFFFF as its stabilization.
+"""
+
+import os
+import re
+import struct
+import sys
+
+MAGIC = b"GoLP"
+VERSION = 3
+WORD_BITS = 64
+NAME = re.compile(r"#[Nn] (.*)")
+SIZE = re.compile(r"x *= *(\d+).+y *= *(\d+).*")
+CURVE_SAMPLES = 16
+ENTRY = struct.Struct("<IIIIiiIIIIIiiIII" + "I" * CURVE_SAMPLES)
+METADATA = "metadata.tsv"
+# Order of PatternGrowth in Utilities/rleparser.h.
+GROWTH = ("unknown", "dies", "still", "oscillates", "moves", "grows", "chaotic")
+NEVER_STABILIZED = 0xFFFFFFFF
+UNKNOWN_BEHAVIOUR = (0, 0, 0, 0, NEVER_STABILIZED, 0, 0) + (0,) * CURVE_SAMPLES
+WORD = struct.Struct("<IIQ")
+
+
+def add_run(words, row, column, count):
+    while count > 0:
+        word_column = column - column % WORD_BITS
+        offset = column - word_column
+        length = min(count, WORD_BITS - offset)
+        bits = ((1 << length) - 1) << offset
+        if words and words[-1][0] == row and words[-1][1] == word_column:
+            words[-1][2] |= bits
+        else:
+            words.append([row, word_column, bits])
+        column += length
+        count -= length
+
+
+def read_pattern(path):
+    name = ""
+    size = None
+    with open(path, encoding="utf-8", errors="replace") as rle:
+        lines = rle.read().splitlines()
+    body = 0
+    for body, line in enumerate(lines, 1):
+        if NAME.fullmatch(line):
+            name = NAME.fullmatch(line).group(1)
+        elif SIZE.fullmatch(line):
+            match = SIZE.fullmatch(line)
+            size = (int(match.group(1)), int(match.group(2)))
+            break
+    if size is None:
+        raise ValueError(path + ": no size line")
+
+    words = []
+    cells = 0
+    x = y = count = 0
+    for char in "".join(lines[body:]):
+        if char == "!":
+            break
+        if char.isdigit():
+            count = count * 10 + int(char)
+            continue
+        count = count if count > 0 else 1
+        if char == "$":
+            x = 0
+            y += count
+        elif char.lower() == "b":
+            x += count
+        elif char.lower() == "o":
+            add_run(words, y, x, count)
+            x += count
+            cells += count
+        count = 0
+    name = name or os.path.splitext(os.path.basename(path))[0]
+    return name, size[0], size[1], cells, words
+
+
+def read_metadata(patterns_dir):
+    path = os.path.join(patterns_dir, METADATA)
+    if not os.path.exists(path):
+        return {}
+    with open(path, encoding="utf-8") as metadata:
+        columns = metadata.readline().rstrip("\n").split("\t")
+        rows = (dict(zip(columns, line.rstrip("\n").split("\t"))) for line in metadata if line.strip())
+        return {row["file"]: behaviour(row) for row in rows}
+
+
+def behaviour(row):
+    stabilization = int(row["stabilization"])
+    curve = [int(sample) for sample in row["curve"].split(",")] if row["curve"] else []
+    curve = (curve + [0] * CURVE_SAMPLES)[:CURVE_SAMPLES]
+    return (GROWTH.index(row["growth"]), int(row["period"]), int(row["dx"]), int(row["dy"]),
+            NEVER_STABILIZED if stabilization < 0 else stabilization, int(row["min"]), int(row["max"])) + tuple(curve)
+
+
+def main(patterns_dir, output):
+    # Case-insensitive like the QDir listing of the RLE resources, both have the same indices.
+    files = sorted((entry for entry in os.listdir(patterns_dir) if entry.endswith(".rle")), key=str.lower)
+    metadata = read_metadata(patterns_dir)
+
+    strings = bytearray()
+    words = bytearray()
+    index = []
+    for entry in files:
+        name, width, height, cells, pattern_words = read_pattern(os.path.join(patterns_dir, entry))
+        name_bytes = name.encode("utf-8")
+        file_bytes = entry.encode("utf-8")
+        name_offset = len(strings)
+        strings += name_bytes
+        file_offset = len(strings)
+        strings += file_bytes
+        index.append([name_offset, len(name_bytes), file_offset, len(file_bytes),
+                      width, height, cells, len(words), len(pattern_words)]
+                     + list(metadata.get(entry, UNKNOWN_BEHAVIOUR)))
+        for word in pattern_words:
+            words += WORD.pack(*word)
+
+    header = struct.pack("<4sII", MAGIC, VERSION, len(index))
+    strings_offset = len(header) + ENTRY.size * len(index)
+    words_offset = strings_offset + len(strings)
+    padding = -words_offset % 8
+    words_offset += padding
+    for entry in index:
+        entry[0] += strings_offset
+        entry[2] += strings_offset
+        entry[7] += words_offset
+
+    with open(output, "wb") as pack:
+        pack.write(header)
+        for entry in index:
+            pack.write(ENTRY.pack(*entry))
+        pack.write(strings)
+        pack.write(b"\0" * padding)
+        pack.write(words)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        sys.exit("usage: packpatterns.py <patterns dir> <output>")
+    main(sys.argv[1], sys.argv[2])
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <iterator>
+
+#include "patternindex.h"
+
+namespace Utilities {
+
+namespace {
+
+constexpr int const c_trigram_size = 3;
+
+quint64 trigram(QString const& text, int position)
+{
+  return static_cast<quint64>(text[position].unicode()) << 32
+      | static_cast<quint64>(text[position + 1].unicode()) << 16
+      | static_cast<quint64>(text[position + 2].unicode());
+}
+
+} // namespace
+
+PatternIndex::PatternIndex(Patterns const& patterns)
+{
+  auto const count = patterns.patternCount();
+  entries_.reserve(count);
+  sorted_names_.reserve(count);
+  for (Logic::SizeT idx = 0; idx < count; ++idx)
+  {
+    auto const& info = patterns.patternInfoAt(idx);
+    auto name = info.name_.toLower();
+    for (int position = 0; position + c_trigram_size <= name.size(); ++position)
+    {
+      auto& postings = trigrams_[trigram(name, position)];
+      if (postings.isEmpty() || postings.back() != idx)
+      {
+        postings.push_back(idx);
+      }
+    }
+    sorted_names_.push_back(qMakePair(name, idx));
+    entries_.push_back({ std::move(name), std::max(info.size_.x(), info.size_.y()), info.cells_, info.behaviour_.growth_ });
+  }
+  std::sort(sorted_names_.begin(), sorted_names_.end());
+}
+
+QVector<Logic::SizeT> PatternIndex::find(PatternQuery const& query) const
+{
+  auto const text = query.text_.trimmed().toLower();
+  QVector<Logic::SizeT> result;
+  if (text.isEmpty())
+  {
+    for (Logic::SizeT idx = 0; idx < entries_.size(); ++idx)
+    {
+      if (matches(entries_[idx], query))
+      {
+        result.push_back(idx);
+      }
+    }
+    return result;
+  }
+
+  auto const candidates = (text.size() < c_trigram_size) ? byPrefix(text) : byTrigrams(text);
+  for (auto const idx : candidates)
+  {
+    if (matches(entries_[idx], query)
+        && (text.size() < c_trigram_size || entries_[idx].name_.contains(text)))
+    {
+      result.push_back(idx);
+    }
+  }
+  return result;
+}
+
+QVector<Logic::SizeT> PatternIndex::byPrefix(QString const& prefix) const
+{
+  QVector<Logic::SizeT> result;
+  auto iter = std::lower_bound(sorted_names_.begin(), sorted_names_.end(), prefix,
+    [](QPair<QString, Logic::SizeT> const& name, QString const& value)
+  {
+    return name.first < value;
+  });
+  for (; iter != sorted_names_.end() && iter->first.startsWith(prefix); ++iter)
+  {
+    result.push_back(iter->second);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// Every trigram of the text has to be in the name, the rarest one goes first.
+QVector<Logic::SizeT> PatternIndex::byTrigrams(QString const& text) const
+{
+  QVector<QVector<Logic::SizeT> const*> postings;
+  for (int position = 0; position + c_trigram_size <= text.size(); ++position)
+  {
+    auto const iter = trigrams_.find(trigram(text, position));
+    if (iter == trigrams_.end())
+    {
+      return {};
+    }
+    postings.push_back(&iter.value());
+  }
+  std::sort(postings.begin(), postings.end(), [](QVector<Logic::SizeT> const* lhs, QVector<Logic::SizeT> const* rhs)
+  {
+    return lhs->size() < rhs->size();
+  });
+
+  auto result = *postings.front();
+  QVector<Logic::SizeT> intersection;
+  for (int idx = 1; idx < postings.size() && !result.isEmpty(); ++idx)
+  {
+    intersection.clear();
+    std::set_intersection(result.begin(), result.end(), postings[idx]->begin(), postings[idx]->end(),
+                          std::back_inserter(intersection));
+    result.swap(intersection);
+  }
+  return result;
+}
+
+bool PatternIndex::matches(Entry const& entry, PatternQuery const& query) const
+{
+  return entry.size_ >= query.min_size_ && entry.size_ <= query.max_size_
+      && entry.cells_ >= query.min_cells_ && entry.cells_ <= query.max_cells_
+      && (query.growth_ == PatternGrowth::Unknown || entry.growth_ == query.growth_);
+}
+
+} // Utilities
@@ -0,0 +1,60 @@
+#ifndef PATTERNINDEX_H
+#define PATTERNINDEX_H
+
+#include <limits>
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include "rleparser.h"
+
+namespace Utilities {
+
+// The scores of a pattern are its cells, so the cell range filters both.
+struct PatternQuery
+{
+  // Name prefix below three characters, any part of the name from three on.
+  QString text_;
+  // Range of the larger side.
+  int min_size_ = 0;
+  int max_size_ = std::numeric_limits<int>::max();
+  Logic::Score min_cells_ = 0;
+  Logic::Score max_cells_ = std::numeric_limits<Logic::Score>::max();
+  // Unknown takes patterns of any behaviour.
+  PatternGrowth growth_ = PatternGrowth::Unknown;
+};
+
+// Built once from the catalog, patterns are never parsed by a search. Short texts
+// are looked up in the sorted names, longer ones intersect the name trigrams.
+class PatternIndex
+{
+public:
+  explicit PatternIndex(Patterns const& patterns);
+
+  // Catalog indices in ascending order.
+  QVector<Logic::SizeT> find(PatternQuery const& query) const;
+
+private:
+  struct Entry
+  {
+    QString name_;
+    int size_;
+    Logic::Score cells_;
+    PatternGrowth growth_;
+  };
+
+  QVector<Logic::SizeT> byPrefix(QString const& prefix) const;
+  QVector<Logic::SizeT> byTrigrams(QString const& text) const;
+  bool matches(Entry const& entry, PatternQuery const& query) const;
+
+  // Names in lower case.
+  QVector<Entry> entries_;
+  QVector<QPair<QString, Logic::SizeT>> sorted_names_;
+  QHash<quint64, QVector<Logic::SizeT>> trigrams_;
+};
+
+} // Utilities
+
+#endif // PATTERNINDEX_H
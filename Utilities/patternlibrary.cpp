@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFuture>
+#include <QtConcurrent>
+
+#include "macrocell.h"
+#include "mappedfile.h"
+#include "patternlibrary.h"
+#include "qtutilities.h"
+
+namespace Utilities {
+
+namespace {
+
+QStringList const c_library_filters { "*.rle", "*.mc" };
+
+bool readInfo(QByteArray const& bytes, PatternInfo& info)
+{
+  if (!isMacrocell(bytes))
+  {
+    return readPatternInfo(bytes, info);
+  }
+  Macrocell const macrocell(bytes);
+  info.name_ = macrocell.name();
+  info.size_ = QPoint(macrocell.bounds().width(), macrocell.bounds().height());
+  info.cells_ = static_cast<Logic::Score>(macrocell.cells());
+  return macrocell.isValid() && info.cells_ > 0;
+}
+
+class PatternLibrary final : public Patterns
+{
+public:
+  explicit PatternLibrary(QString const& path)
+  {
+    QDirIterator files(path, c_library_filters, QDir::Files, QDirIterator::Subdirectories);
+    while (files.hasNext())
+    {
+      paths_.push_back(files.next());
+    }
+    std::sort(paths_.begin(), paths_.end());
+
+    catalog_.resize(paths_.size());
+    indexed_.reset(new std::once_flag[paths_.size()]);
+    indexing_ = QtConcurrent::run([this]
+    {
+      for (size_t idx = 0; idx < paths_.size() && !stop_indexing_.load(std::memory_order_relaxed); ++idx)
+      {
+        index(idx);
+      }
+    });
+  }
+  ~PatternLibrary() override
+  {
+    stop_indexing_.store(true, std::memory_order_relaxed);
+    indexing_.waitForFinished();
+  }
+
+  Logic::SizeT patternCount() const override
+  {
+    return static_cast<Logic::SizeT>(paths_.size());
+  }
+  PatternInfo const& patternInfoAt(Logic::SizeT idx) const override
+  {
+    Q_ASSERT(idx >= 0 && idx < patternCount());
+    index(static_cast<size_t>(idx));
+    return catalog_[static_cast<size_t>(idx)];
+  }
+  // Files without a pattern in them are kept as empty patterns, indices stay stable.
+  Logic::PatternPtr parsePatternAt(Logic::SizeT idx) const override
+  {
+    auto const& info = patternInfoAt(idx);
+    auto const file = Qt::makeShared<MappedFile const>(info.path_);
+    if (info.cells_ == 0 || !file->isValid())
+    {
+      return createPattern(info.name_, QPoint(1, 1), {});
+    }
+    // The quadtree is far smaller than the file, it doesn't need the mapping.
+    if (isMacrocell(file->bytes()))
+    {
+      return createMacrocellPattern(info.name_, file->bytes());
+    }
+    return createRlePattern(file->bytes(), file);
+  }
+  Logic::SizeT preloadCount() const override
+  {
+    return 0;
+  }
+
+private:
+  void index(size_t idx) const
+  {
+    std::call_once(indexed_[idx], [this, idx]
+    {
+      auto& info = catalog_[idx];
+      MappedFile const file(paths_[idx]);
+      if (!file.isValid() || !readInfo(file.bytes(), info))
+      {
+        qDebug() << "No pattern in" << paths_[idx];
+        info = PatternInfo();
+      }
+      if (info.name_.isEmpty())
+      {
+        info.name_ = QFileInfo(paths_[idx]).completeBaseName();
+      }
+      info.path_ = paths_[idx];
+    });
+  }
+
+  std::vector<QString> paths_;
+  std::vector<PatternInfo> mutable catalog_;
+  std::unique_ptr<std::once_flag[]> indexed_;
+  std::atomic<bool> stop_indexing_ { false };
+  QFuture<void> indexing_;
+};
+
+class JoinedPatterns final : public Patterns
+{
+public:
+  explicit JoinedPatterns(QVector<PatternsPtr> all_patterns)
+    : all_patterns_(std::move(all_patterns))
+  {
+    Logic::SizeT first = 0;
+    for (auto const& patterns : all_patterns_)
+    {
+      first_indices_.push_back(first);
+      first += patterns->patternCount();
+    }
+    pattern_count_ = first;
+  }
+
+  Logic::SizeT patternCount() const override
+  {
+    return pattern_count_;
+  }
+  PatternInfo const& patternInfoAt(Logic::SizeT idx) const override
+  {
+    auto const source = sourceOf(idx);
+    return all_patterns_[source]->patternInfoAt(idx - first_indices_[source]);
+  }
+  Logic::PatternPtr parsePatternAt(Logic::SizeT idx) const override
+  {
+    auto const source = sourceOf(idx);
+    return all_patterns_[source]->parsePatternAt(idx - first_indices_[source]);
+  }
+  // Up to the first source not preloaded entirely.
+  Logic::SizeT preloadCount() const override
+  {
+    Logic::SizeT count = 0;
+    for (auto const& patterns : all_patterns_)
+    {
+      count += patterns->preloadCount();
+      if (patterns->preloadCount() < patterns->patternCount())
+      {
+        break;
+      }
+    }
+    return count;
+  }
+
+private:
+  int sourceOf(Logic::SizeT idx) const
+  {
+    Q_ASSERT(idx >= 0 && idx < patternCount());
+    auto const next = std::upper_bound(first_indices_.begin(), first_indices_.end(), idx);
+    return static_cast<int>(std::distance(first_indices_.begin(), next)) - 1;
+  }
+
+  QVector<PatternsPtr> const all_patterns_;
+  QVector<Logic::SizeT> first_indices_;
+  Logic::SizeT pattern_count_ = 0;
+};
+
+} // namespace
+
+PatternsPtr loadPatternLibrary(QString const& path)
+{
+  if (!QDir(path).exists())
+  {
+    qDebug() << "No pattern library" << path;
+    return nullptr;
+  }
+  auto library = Qt::makeShared<PatternLibrary>(path);
+  qDebug() << "Pattern library" << path << ":" << library->patternCount() << "patterns";
+  return library;
+}
+
+PatternsPtr joinPatterns(QVector<PatternsPtr> all_patterns)
+{
+  return Qt::makeShared<JoinedPatterns>(std::move(all_patterns));
+}
+
+} // Utilities
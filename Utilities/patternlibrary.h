@@ -0,0 +1,17 @@
+#ifndef PATTERNLIBRARY_H
+#define PATTERNLIBRARY_H
+
+#include "rleparser.h"
+
+namespace Utilities {
+
+// RLE and Macrocell files found under the directory. Only the file names are listed upfront,
+// headers are indexed in the background or on the first request and the files
+// are mapped when a pattern is parsed. nullptr when the directory doesn't exist.
+PatternsPtr loadPatternLibrary(QString const& path);
+// Patterns of every source one after another.
+PatternsPtr joinPatterns(QVector<PatternsPtr> all_patterns);
+
+} // Utilities
+
+#endif // PATTERNLIBRARY_H
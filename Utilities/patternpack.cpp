@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <memory>
+#include <mutex>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QStringList>
+#include <QtEndian>
+
+#include "mappedfile.h"
+#include "patternpack.h"
+#include "qtutilities.h"
+
+namespace Utilities {
+
+namespace {
+
+constexpr char const c_magic[] = { 'G', 'o', 'L', 'P' };
+constexpr quint32 const c_version = 3;
+constexpr qint64 const c_header_size = 12;
+constexpr qint64 const c_entry_size = 64 + 4 * c_population_curve_samples;
+constexpr quint32 const c_growth_count = static_cast<quint32>(PatternGrowth::Chaotic) + 1;
+constexpr qint64 const c_word_size = 16;
+constexpr auto const* c_resource_prefix = ":/Patterns/Patterns/";
+
+struct PackEntry
+{
+  qint64 words_offset_ = 0;
+  qint64 word_count_ = 0;
+};
+
+quint32 readU32(uchar const* data)
+{
+  return qFromLittleEndian<quint32>(data);
+}
+
+// Cells stay in the mapped pack. Its words hold them in RLE order, rows counted
+// from the top, and are repacked into the identity bitmap on the first request.
+// The other variants are transformed from its words.
+class PackedPattern final : public Logic::Pattern
+{
+public:
+  explicit PackedPattern(PatternInfo const& info, uchar const* words, qint64 word_count,
+                         QSharedPointer<MappedFile const> file)
+    : file_(std::move(file))
+    , words_(words)
+    , word_count_(word_count)
+    , name_(info.name_)
+    , size_(info.size_)
+    , cells_(info.cells_)
+  {}
+
+  QString name() const override
+  {
+    return name_;
+  }
+  Logic::Points const& points() const override
+  {
+    std::call_once(points_read_, [this]
+    {
+      points_.reserve(static_cast<int>(cells_));
+      auto const size = size_;
+      auto& points = points_;
+      readRuns([size, &points](int x, int y, int length)
+      {
+        for (auto const end = x + length; x < end; ++x)
+        {
+          points.push_back(QPoint(x, size.y() - y - 1) - size / 2);
+        }
+      });
+    });
+    return points_;
+  }
+  QPoint size() const override
+  {
+    return size_;
+  }
+  Logic::Score scores() const override
+  {
+    return cells_;
+  }
+  Logic::PatternBitmap const& bitmap(Logic::PatternVariant variant) const override
+  {
+    Q_ASSERT(variant < Logic::c_pattern_variants);
+    std::call_once(bitmaps_built_[variant], [this, variant]
+    {
+      if (variant != 0)
+      {
+        bitmaps_[variant] = Logic::transformPatternBitmap(bitmap(0), variant);
+        return;
+      }
+      QRect bounds;
+      readRuns([&bounds](int x, int y, int length)
+      {
+        bounds |= QRect(x, y, length, 1);
+      });
+      PatternBitmapWriter writer(size_, bounds);
+      readRuns([&writer](int x, int y, int length)
+      {
+        writer.addRun(x, y, length);
+      });
+      bitmaps_[0] = writer.finish();
+    });
+    return bitmaps_[variant];
+  }
+
+private:
+  // Every word is split into its runs of live cells.
+  template <typename RunHandler>
+  void readRuns(RunHandler&& handler) const
+  {
+    for (qint64 word = 0; word < word_count_; ++word)
+    {
+      auto const* record = words_ + word * c_word_size;
+      auto const row = static_cast<int>(readU32(record));
+      auto const column = static_cast<int>(readU32(record + 4));
+      auto bits = qFromLittleEndian<quint64>(record + 8);
+      while (bits != 0)
+      {
+        auto const start = static_cast<int>(qCountTrailingZeroBits(bits));
+        auto const rest = ~(bits >> start);
+        auto const length = (rest == 0) ? 64 - start : static_cast<int>(qCountTrailingZeroBits(rest));
+        handler(column + start, row, length);
+        bits &= (length + start == 64) ? 0 : ~quint64(0) << (start + length);
+      }
+    }
+  }
+
+  QSharedPointer<MappedFile const> const file_;
+  uchar const* const words_;
+  qint64 const word_count_;
+  QString const name_;
+  QPoint const size_;
+  Logic::Score const cells_;
+
+  mutable std::once_flag points_read_;
+  mutable Logic::Points points_;
+  mutable std::array<std::once_flag, Logic::c_pattern_variants> bitmaps_built_;
+  mutable std::array<Logic::PatternBitmap, Logic::c_pattern_variants> bitmaps_;
+};
+
+class PackedPatterns final : public Patterns
+{
+public:
+  explicit PackedPatterns(QString const& path)
+    : file_(Qt::makeShared<MappedFile const>(path))
+  {
+    if (!file_->isValid() || file_->bytes().size() < c_header_size)
+    {
+      return;
+    }
+    size_ = file_->bytes().size();
+    data_ = reinterpret_cast<uchar const*>(file_->bytes().constData());
+    if (!std::equal(std::begin(c_magic), std::end(c_magic), data_)
+        || readU32(data_ + 4) != c_version)
+    {
+      qDebug() << "Invalid pattern pack" << path;
+      data_ = nullptr;
+      return;
+    }
+
+    auto const count = static_cast<qint64>(readU32(data_ + 8));
+    if (c_header_size + count * c_entry_size > size_)
+    {
+      data_ = nullptr;
+      return;
+    }
+    catalog_.reserve(static_cast<int>(count));
+    entries_.reserve(static_cast<size_t>(count));
+    for (qint64 idx = 0; idx < count; ++idx)
+    {
+      auto const* entry = data_ + c_header_size + idx * c_entry_size;
+      qint64 const name_offset = readU32(entry);
+      qint64 const name_size = readU32(entry + 4);
+      qint64 const file_offset = readU32(entry + 8);
+      qint64 const file_size = readU32(entry + 12);
+      PackEntry pack_entry;
+      pack_entry.words_offset_ = readU32(entry + 28);
+      pack_entry.word_count_ = readU32(entry + 32);
+      if (name_offset + name_size > size_ || file_offset + file_size > size_
+          || pack_entry.words_offset_ + pack_entry.word_count_ * c_word_size > size_)
+      {
+        qDebug() << "Corrupted pattern pack" << path;
+        data_ = nullptr;
+        return;
+      }
+
+      PatternInfo info;
+      info.name_ = QString::fromUtf8(reinterpret_cast<char const*>(data_ + name_offset), static_cast<int>(name_size));
+      info.size_ = QPoint(qFromLittleEndian<qint32>(entry + 16), qFromLittleEndian<qint32>(entry + 20));
+      info.cells_ = readU32(entry + 24);
+      info.path_ = c_resource_prefix
+          + QString::fromUtf8(reinterpret_cast<char const*>(data_ + file_offset), static_cast<int>(file_size));
+      auto const growth = readU32(entry + 36);
+      info.behaviour_.growth_ = (growth < c_growth_count) ? static_cast<PatternGrowth>(growth) : PatternGrowth::Unknown;
+      info.behaviour_.period_ = readU32(entry + 40);
+      info.behaviour_.displacement_ = QPoint(qFromLittleEndian<qint32>(entry + 44), qFromLittleEndian<qint32>(entry + 48));
+      info.behaviour_.stabilization_ = readU32(entry + 52);
+      info.behaviour_.min_population_ = readU32(entry + 56);
+      info.behaviour_.max_population_ = readU32(entry + 60);
+      for (int sample = 0; sample < c_population_curve_samples; ++sample)
+      {
+        info.behaviour_.curve_[static_cast<size_t>(sample)] = readU32(entry + 64 + 4 * sample);
+      }
+      catalog_.push_back(std::move(info));
+      entries_.push_back(pack_entry);
+    }
+  }
+
+  bool isValid() const
+  {
+    return data_ != nullptr;
+  }
+
+  Logic::SizeT patternCount() const override
+  {
+    return static_cast<Logic::SizeT>(catalog_.size());
+  }
+  PatternInfo const& patternInfoAt(Logic::SizeT idx) const override
+  {
+    Q_ASSERT(idx >= 0 && idx < patternCount());
+    return catalog_[idx];
+  }
+  Logic::PatternPtr parsePatternAt(Logic::SizeT idx) const override
+  {
+    auto const& entry = entries_[static_cast<size_t>(idx)];
+    return Qt::makeShared<PackedPattern>(patternInfoAt(idx), data_ + entry.words_offset_, entry.word_count_, file_);
+  }
+
+private:
+  QSharedPointer<MappedFile const> const file_;
+  qint64 size_ = 0;
+  uchar const* data_ = nullptr;
+  QVector<PatternInfo> catalog_;
+  std::vector<PackEntry> entries_;
+};
+
+// Next to the executable, in the bundle resources on macOS and one level up
+// for the debug and release directories on Windows.
+QStringList patternPackPaths()
+{
+  auto const directory = QCoreApplication::applicationDirPath();
+  return
+  {
+    directory + "/patterns.pack",
+    directory + "/../Resources/patterns.pack",
+    directory + "/../patterns.pack",
+  };
+}
+
+} // namespace
+
+PatternsPtr loadPatternPack()
+{
+  for (auto const& path : patternPackPaths())
+  {
+    if (!QFile::exists(path))
+    {
+      continue;
+    }
+    auto patterns = Qt::makeShared<PackedPatterns>(path);
+    if (patterns->isValid())
+    {
+      qDebug() << "Pattern pack" << path << ":" << patterns->patternCount() << "patterns";
+      return patterns;
+    }
+  }
+  return nullptr;
+}
+
+} // Utilities
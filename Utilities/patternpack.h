@@ -0,0 +1,14 @@
+#ifndef PATTERNPACK_H
+#define PATTERNPACK_H
+
+#include "rleparser.h"
+
+namespace Utilities {
+
+// Patterns of the pack written by packpatterns.py at build time. The file is mapped
+// and cells are read straight from it, nullptr when no valid pack is installed.
+PatternsPtr loadPatternPack();
+
+} // Utilities
+
+#endif // PATTERNPACK_H
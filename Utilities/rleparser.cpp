@@ -1,121 +1,145 @@
-#include <tuple>
+#include <algorithm>
+#include <mutex>
 
 #include <QDir>
+#include <QRect>
 #include <QResource>
-#include <QTextStream>
-#include <QRegExp>
-#include <QException>
+#include <QSettings>
 
 #include "rleparser.h"
+#include "rlereader.h"
+#include "patternlibrary.h"
+#include "patternpack.h"
 #include "qtutilities.h"
 
 namespace Utilities {
 
 namespace {
 
-void readPoints(QTextStream& stream, QPoint size, Logic::Points& points)
+using Logic::c_pattern_bitmap_word_bits;
+
+// Zero-copy for the uncompressed resources, they live as long as the application.
+QByteArray resourceBytes(QResource const& resource)
 {
-  int cell_x = 0;
-  int cell_y = 0;
-  int index = 0;
+  auto const byte_count = static_cast<int>(resource.size());
+  if (resource.isCompressed())
+  {
+    return qUncompress(resource.data(), byte_count);
+  }
+  return QByteArray::fromRawData(reinterpret_cast<char const*>(resource.data()), byte_count);
+}
 
-  QString line;
-  while (stream.readLineInto(&line))
+// Only the header is kept after the cells are counted, the points are made
+// from the bytes on the first request and the stamped bitmaps without them.
+class RlePattern final : public Logic::Pattern
+{
+public:
+  explicit RlePattern(QByteArray bytes, QSharedPointer<MappedFile const> file)
+    : file_(std::move(file))
+    , bytes_(std::move(bytes))
   {
-    Q_ASSERT(QRegExp("[\\dboxy$!]+").exactMatch(line));
+    RleReader reader(bytes_.constData(), bytes_.constData() + bytes_.size());
+    RleHeader header;
+    auto const has_header = reader.readHeader(header);
+    Q_ASSERT(has_header);
+    Q_UNUSED(has_header);
+    name_ = std::move(header.name_);
+    size_ = header.size_;
+    body_ = static_cast<int>(reader.position() - bytes_.constData());
 
-    for (QChar const c : line)
+    auto const ok = reader.readRuns([this](int x, int y, int length)
     {
-      if (c == '!')
-      {
-        return;
-      }
-      else if (c.isDigit())
-      {
-        index *= 10;
-        index += c.digitValue();
-      }
-      else
+      bounds_ |= QRect(x, y, length, 1);
+      cells_ += static_cast<Logic::Score>(length);
+    });
+    Q_ASSERT(ok);
+    Q_UNUSED(ok);
+
+    Q_ASSERT(!name_.isEmpty());
+    Q_ASSERT(size_ != QPoint());
+    Q_ASSERT(cells_ > 0);
+  }
+
+  QString name() const override
+  {
+    return name_;
+  }
+  Logic::Points const& points() const override
+  {
+    std::call_once(points_read_, [this]
+    {
+      points_.reserve(static_cast<int>(cells_));
+      auto const size = size_;
+      auto& points = points_;
+      body().readRuns([size, &points](int x, int y, int length)
       {
-        index = (index > 0) ? index : 1;
-        if (c == '$')
-        {
-          cell_x = 0;
-          cell_y += index;
-        }
-        else if (c.toLower() == 'b')
+        for (auto const end = x + length; x < end; ++x)
         {
-          cell_x += index;
+          points.push_back(QPoint(x, size.y() - y - 1) - size / 2);
         }
-        else /*if (c.toLower()  == 'o')*/
-        {
-          for (int x = 0; x < index; ++x, ++cell_x)
-          {
-            QPoint unit(cell_x, size.y() - cell_y - 1);
-            points.push_back(unit - size / 2);
-          }
-        }
-        index = 0;
+      });
+    });
+    return points_;
+  }
+  QPoint size() const override
+  {
+    return size_;
+  }
+  Logic::Score scores() const override
+  {
+    return cells_;
+  }
+  Logic::PatternBitmap const& bitmap(Logic::PatternVariant variant) const override
+  {
+    Q_ASSERT(variant < Logic::c_pattern_variants);
+    std::call_once(bitmaps_built_[variant], [this, variant]
+    {
+      if (variant != 0)
+      {
+        bitmaps_[variant] = Logic::transformPatternBitmap(bitmap(0), variant);
+        return;
       }
-      Q_ASSERT(cell_x >= 0 && cell_x <= size.x());
-      Q_ASSERT(cell_y >= 0 && cell_y <= size.y());
-    }
+      PatternBitmapWriter writer(size_, bounds_);
+      auto const ok = body().readRuns([&writer](int x, int y, int length)
+      {
+        writer.addRun(x, y, length);
+      });
+      Q_ASSERT(ok);
+      Q_UNUSED(ok);
+      bitmaps_[0] = writer.finish();
+    });
+    return bitmaps_[variant];
   }
-  Q_ASSERT(false);
-}
-
-std::tuple<QString, QPoint, Logic::Points> readPattern(QTextStream& stream)
-{
-  QRegExp rname("#[Nn] (.*)");
-  QRegExp rsize("x *= *(\\d+).+y *= *(\\d+).*");
-
-  QString name;
-  QPoint size;
-  Logic::Points points;
 
-  QString line;
-  while (stream.readLineInto(&line))
+private:
+  RleReader body() const
   {
-    if (rname.exactMatch(line))
-    {
-      Q_ASSERT(rname.captureCount() > 0);
-      name = rname.cap(1);
-    }
-    else if (rsize.exactMatch(line))
-    {
-      Q_ASSERT(rsize.captureCount() > 1);
-      size = QPoint(rsize.cap(1).toInt(), rsize.cap(2).toInt());
-      break;
-    }
+    return RleReader(bytes_.constData() + body_, bytes_.constData() + bytes_.size());
   }
-  readPoints(stream, size, points);
-  return std::make_tuple(std::move(name), size, std::move(points));
-}
 
+  QSharedPointer<MappedFile const> const file_;
+  QByteArray const bytes_;
+  QString name_;
+  QPoint size_;
+  int body_ = 0;
+  QRect bounds_;
+  Logic::Score cells_ = 0;
+
+  mutable std::once_flag points_read_;
+  mutable Logic::Points points_;
+  mutable std::array<std::once_flag, Logic::c_pattern_variants> bitmaps_built_;
+  mutable std::array<Logic::PatternBitmap, Logic::c_pattern_variants> bitmaps_;
+};
+
+// Points known in advance, as read from the pattern pack.
 class PatternImpl final : public Logic::Pattern
 {
 public:
-  explicit PatternImpl(QResource const& resource)
-  {
-    QByteArray bytes;
-    auto const byte_count = static_cast<int>(resource.size());
-    if (resource.isCompressed())
-    {
-      bytes = qUncompress(resource.data(), byte_count);
-    }
-    else
-    {
-      bytes = QByteArray(reinterpret_cast<char const*>(resource.data()), byte_count);
-    }
-    Q_ASSERT(!bytes.isEmpty());
-
-    QTextStream stream(bytes);
-    std::tie(name_, size_, points_) = readPattern(stream);
-
-    Q_ASSERT(!name_.isEmpty());
-    Q_ASSERT(size_ != QPoint());
-    Q_ASSERT(!points_.empty());
-  }
+  explicit PatternImpl(QString name, QPoint size, Logic::Points points)
+    : name_(std::move(name))
+    , size_(size)
+    , points_(std::move(points))
+  {}
 
   QString name() const override
   {
@@ -133,45 +157,170 @@ public:
   {
     return points_.size();
   }
+  Logic::PatternBitmap const& bitmap(Logic::PatternVariant variant) const override
+  {
+    return bitmaps_.bitmap(variant);
+  }
 
 private:
   QString name_;
   QPoint size_;
   Logic::Points points_;
+  Logic::PatternBitmaps const bitmaps_ { points_ };
 };
 
+// Only the directory is listed up front. Every resource is decompressed and its
+// cells counted on the first lookup of its entry, from whichever thread asks.
 class PatternsImpl final : public Patterns
 {
 public:
   explicit PatternsImpl(QString patterns_path)
-    : patterns_(patterns_path)
   {
-    Q_ASSERT(!patterns_.isEmpty(QDir::Files));
+    QDir const patterns(patterns_path);
+    Q_ASSERT(!patterns.isEmpty(QDir::Files));
+    // The order of packpatterns.py, the pack and the resources have the same indices.
+    auto const files = patterns.entryInfoList({ "*.rle" }, QDir::Files, QDir::Name | QDir::IgnoreCase);
+    catalog_.resize(static_cast<size_t>(files.size()));
+    read_.reset(new std::once_flag[catalog_.size()]);
+    for (int idx = 0; idx < files.size(); ++idx)
+    {
+      catalog_[static_cast<size_t>(idx)].path_ = files[idx].filePath();
+    }
   }
 
   Logic::SizeT patternCount() const override
   {
-    return static_cast<Logic::SizeT>(patterns_.count());
+    return static_cast<Logic::SizeT>(catalog_.size());
+  }
+  PatternInfo const& patternInfoAt(Logic::SizeT idx) const override
+  {
+    Q_ASSERT(idx >= 0 && idx < patternCount());
+    auto& info = catalog_[static_cast<size_t>(idx)];
+    std::call_once(read_[static_cast<size_t>(idx)], [&info]
+    {
+      QResource const resource(info.path_);
+      Q_ASSERT(resource.isValid());
+      auto const has_pattern = readPatternInfo(resourceBytes(resource), info);
+      Q_ASSERT(has_pattern);
+      Q_UNUSED(has_pattern);
+    });
+    return info;
   }
   Logic::PatternPtr parsePatternAt(Logic::SizeT idx) const override
   {
     Q_ASSERT(idx >= 0 && idx < patternCount());
-    auto const all_patterns = patterns_.entryInfoList(QDir::Files);
-    auto const& file_info = all_patterns.at(idx);
-    QResource const resource(file_info.filePath());
+    QResource const resource(catalog_[static_cast<size_t>(idx)].path_);
     Q_ASSERT(resource.isValid());
-    return Qt::makeShared<PatternImpl>(resource);
+    return createRlePattern(resourceBytes(resource));
   }
 
 private:
-  QDir const patterns_;
+  mutable std::vector<PatternInfo> catalog_;
+  std::unique_ptr<std::once_flag[]> read_;
 };
 
 } // namespace
 
+PatternBitmapWriter::PatternBitmapWriter(QPoint size, QRect bounds)
+  : size_(size)
+  , bounds_(bounds)
+{}
+
+void PatternBitmapWriter::addRun(int x, int y, int length)
+{
+  auto const row = static_cast<uint32_t>(bounds_.bottom() - y);
+  auto column = static_cast<uint32_t>(x - bounds_.left());
+  auto remaining = static_cast<uint32_t>(length);
+  while (remaining > 0)
+  {
+    auto const word_column = column - column % c_pattern_bitmap_word_bits;
+    auto const offset = column % c_pattern_bitmap_word_bits;
+    auto const count = std::min(remaining, c_pattern_bitmap_word_bits - offset);
+    auto const mask = (count == c_pattern_bitmap_word_bits) ? ~uint64_t(0) : ((uint64_t(1) << count) - 1);
+    if (words_.empty() || words_.back().row_ != row || words_.back().column_ != word_column)
+    {
+      words_.push_back({ row, word_column, 0 });
+    }
+    words_.back().bits_ |= mask << offset;
+    column += count;
+    remaining -= count;
+  }
+}
+
+Logic::PatternBitmap PatternBitmapWriter::finish()
+{
+  // Runs go down while the bitmap rows go up, columns stay in order.
+  std::stable_sort(words_.begin(), words_.end(), [](Word const& lhs, Word const& rhs)
+  {
+    return lhs.row_ < rhs.row_;
+  });
+
+  Logic::PatternBitmap result;
+  if (words_.empty())
+  {
+    return result;
+  }
+  result.origin_ = QPoint(bounds_.left(), size_.y() - bounds_.bottom() - 1) - size_ / 2;
+  result.size_ = QPoint(bounds_.width(), bounds_.height());
+  result.rows_.reserve(words_.size());
+  result.columns_.reserve(words_.size());
+  result.words_.reserve(words_.size());
+  for (auto const& word : words_)
+  {
+    result.rows_.push_back(word.row_);
+    result.columns_.push_back(word.column_);
+    result.words_.push_back(word.bits_);
+  }
+  words_.clear();
+  return result;
+}
+
+Logic::PatternPtr createPattern(QString name, QPoint size, Logic::Points points)
+{
+  return Qt::makeShared<PatternImpl>(std::move(name), size, std::move(points));
+}
+
+Logic::PatternPtr createRlePattern(QByteArray bytes, QSharedPointer<MappedFile const> file)
+{
+  return Qt::makeShared<RlePattern>(std::move(bytes), std::move(file));
+}
+
+bool readPatternInfo(QByteArray const& bytes, PatternInfo& info)
+{
+  RleReader reader(bytes.constData(), bytes.constData() + bytes.size());
+  RleHeader header;
+  if (!reader.readHeader(header))
+  {
+    return false;
+  }
+  info.name_ = std::move(header.name_);
+  info.size_ = header.size_;
+  info.cells_ = 0;
+  auto const ok = reader.readRuns([&info](int, int, int length)
+  {
+    info.cells_ += static_cast<Logic::Score>(length);
+  });
+  return ok && info.cells_ > 0;
+}
+
 PatternsPtr createPatterns()
 {
-  return Qt::makeShared<PatternsImpl>(":/Patterns/Patterns");
+  auto built_in = loadPatternPack();
+  if (built_in == nullptr)
+  {
+    built_in = Qt::makeShared<PatternsImpl>(":/Patterns/Patterns");
+  }
+
+  QSettings const settings("GoL", "Patterns");
+  QVector<PatternsPtr> all_patterns { built_in };
+  for (auto const& path : settings.value("libraries").toStringList())
+  {
+    if (auto library = loadPatternLibrary(path))
+    {
+      all_patterns.push_back(std::move(library));
+    }
+  }
+  return (all_patterns.size() > 1) ? joinPatterns(std::move(all_patterns)) : built_in;
 }
 
 } // Utilities
@@ -1,22 +1,109 @@
 #ifndef RLEPARSER_H
 #define RLEPARSER_H
 
+#include <array>
+#include <vector>
+
+#include <QByteArray>
 #include <QVector>
 #include <QSet>
 #include <QPoint>
+#include <QRect>
+#include <QString>
 
 #include "../GameLogic/gamemodel.h"
 
 namespace Utilities {
 
+// How a pattern evolves alone, in the order written by characterizepatterns.py.
+enum class PatternGrowth : uint8_t
+{
+  Unknown,
+  Dies,
+  Still,
+  Oscillates,
+  Moves,
+  Grows,
+  Chaotic,
+};
+
+constexpr uint32_t const c_never_stabilized = 0xFFFFFFFF;
+constexpr int const c_population_curve_samples = 16;
+
+// Measured offline for the patterns of the pack, unknown for the others.
+struct PatternBehaviour
+{
+  PatternGrowth growth_ = PatternGrowth::Unknown;
+  uint32_t period_ = 0;
+  // Per period, rows counted from the top.
+  QPoint displacement_;
+  // c_never_stabilized when no cycle nor death was reached.
+  uint32_t stabilization_ = c_never_stabilized;
+  uint32_t min_population_ = 0;
+  uint32_t max_population_ = 0;
+  // Population at evenly spaced generations of the simulation.
+  std::array<uint32_t, c_population_curve_samples> curve_ {};
+};
+
+struct PatternInfo
+{
+  QString name_;
+  QPoint size_;
+  Logic::Score cells_ = 0;
+  QString path_;
+  PatternBehaviour behaviour_;
+};
+
 struct Patterns
 {
   virtual ~Patterns() = default;
   virtual Logic::SizeT patternCount() const = 0;
+  // Known without parsing the pattern cells.
+  virtual PatternInfo const& patternInfoAt(Logic::SizeT idx) const = 0;
   virtual Logic::PatternPtr parsePatternAt(Logic::SizeT idx) const = 0;
+  // The first patterns worth parsing ahead of time, the external libraries are
+  // too large and parsed on request only.
+  virtual Logic::SizeT preloadCount() const
+  {
+    return patternCount();
+  }
 };
 using PatternsPtr = QSharedPointer<Patterns const>;
+class MappedFile;
+
+// Packs the live runs of a pattern into the bitmap of its identity variant without
+// a point list. Runs come in rows counted from the top, a row at a time with growing
+// columns. The bounds hold every live cell in the same coordinates.
+class PatternBitmapWriter
+{
+public:
+  explicit PatternBitmapWriter(QPoint size, QRect bounds);
+
+  void addRun(int x, int y, int length);
+  Logic::PatternBitmap finish();
+
+private:
+  struct Word
+  {
+    uint32_t row_;
+    uint32_t column_;
+    uint64_t bits_;
+  };
+
+  QPoint const size_;
+  QRect const bounds_;
+  std::vector<Word> words_;
+};
+
+// The binary pattern pack when it is installed, the RLE resources otherwise,
+// followed by the external libraries listed in the settings.
 PatternsPtr createPatterns();
+Logic::PatternPtr createPattern(QString name, QPoint size, Logic::Points points);
+// The points are read from the bytes on the first request, the file keeps
+// mapped bytes alive as long as the pattern.
+Logic::PatternPtr createRlePattern(QByteArray bytes, QSharedPointer<MappedFile const> file = nullptr);
+// Name, size and cells of RLE bytes, false when they hold no pattern.
+bool readPatternInfo(QByteArray const& bytes, PatternInfo& info);
 
 } // Utilities
 
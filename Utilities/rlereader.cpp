@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstring>
+
+#include <QPair>
+
+#include "rlereader.h"
+
+namespace Utilities {
+
+namespace {
+
+using Span = QPair<char const*, char const*>;
+
+Span trimmed(char const* begin, char const* end)
+{
+  while (begin != end && (*begin == ' ' || *begin == '\t'))
+  {
+    ++begin;
+  }
+  while (end != begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+  {
+    --end;
+  }
+  return qMakePair(begin, end);
+}
+
+QString toString(Span span)
+{
+  return QString::fromUtf8(span.first, static_cast<int>(span.second - span.first));
+}
+
+int toInt(Span span)
+{
+  auto result = 0;
+  auto sign = 1;
+  auto const* iter = span.first;
+  if (iter != span.second && *iter == '-')
+  {
+    sign = -1;
+    ++iter;
+  }
+  for (; iter != span.second && *iter >= '0' && *iter <= '9'; ++iter)
+  {
+    result = result * 10 + (*iter - '0');
+  }
+  return sign * result;
+}
+
+QPoint toPoint(Span span)
+{
+  auto const* separator = span.first;
+  while (separator != span.second && *separator != ' ' && *separator != '\t')
+  {
+    ++separator;
+  }
+  return QPoint(toInt(trimmed(span.first, separator)), toInt(trimmed(separator, span.second)));
+}
+
+// "x = m, y = n, rule = B3/S23", the keys may come in any order.
+bool readSize(Span line, RleHeader& header)
+{
+  auto found = false;
+  auto const* begin = line.first;
+  while (begin != line.second)
+  {
+    auto const* end = std::find(begin, line.second, ',');
+    auto const* equals = std::find(begin, end, '=');
+    if (equals != end)
+    {
+      auto const key = trimmed(begin, equals);
+      auto const value = trimmed(equals + 1, end);
+      auto const key_size = key.second - key.first;
+      if (key_size == 1 && *key.first == 'x')
+      {
+        header.size_.setX(toInt(value));
+        found = true;
+      }
+      else if (key_size == 1 && *key.first == 'y')
+      {
+        header.size_.setY(toInt(value));
+      }
+      else if (key_size == 4 && std::strncmp(key.first, "rule", 4) == 0)
+      {
+        header.rule_ = toString(value);
+      }
+    }
+    begin = (end == line.second) ? end : end + 1;
+  }
+  return found;
+}
+
+} // namespace
+
+bool RleReader::readHeader(RleHeader& header)
+{
+  while (position_ != end_)
+  {
+    auto const* line_end = std::find(position_, end_, '\n');
+    auto const line = trimmed(position_, line_end);
+    position_ = (line_end == end_) ? end_ : line_end + 1;
+    if (line.first == line.second)
+    {
+      continue;
+    }
+
+    if (*line.first == '#')
+    {
+      auto const type = (line.second - line.first > 1) ? line.first[1] : '\0';
+      auto const value = trimmed(std::min(line.first + 2, line.second), line.second);
+      switch (type)
+      {
+      case 'N':
+      case 'n':
+        header.name_ = toString(value);
+        break;
+      case 'C':
+      case 'c':
+        header.comments_.push_back(toString(value));
+        break;
+      case 'O':
+        header.author_ = toString(value);
+        break;
+      case 'R':
+      case 'P':
+        header.offset_ = toPoint(value);
+        break;
+      default:
+        break;
+      }
+    }
+    else if (readSize(line, header))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // Utilities
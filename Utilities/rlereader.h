@@ -0,0 +1,93 @@
+#ifndef RLEREADER_H
+#define RLEREADER_H
+
+#include <QPoint>
+#include <QString>
+#include <QStringList>
+
+namespace Utilities {
+
+struct RleHeader
+{
+  QString name_;
+  QString author_;
+  QStringList comments_;
+  // Top-left cell from #R or #P lines.
+  QPoint offset_;
+  QPoint size_;
+  QString rule_;
+};
+
+// Reads RLE straight from the bytes without copying them. Live cells reach
+// the visitor as horizontal runs, rows are counted from the top.
+class RleReader
+{
+public:
+  explicit RleReader(char const* begin, char const* end)
+    : position_(begin)
+    , end_(end)
+  {}
+
+  // Stops after the "x = m, y = n" line, false when there is none.
+  bool readHeader(RleHeader& header);
+  // Calls visitor(x, y, length) for every run of live cells, false when '!' is missing.
+  template<typename RunVisitor>
+  bool readRuns(RunVisitor&& visitor);
+
+  char const* position() const
+  {
+    return position_;
+  }
+
+private:
+  char const* position_ = nullptr;
+  char const* const end_ = nullptr;
+};
+
+template<typename RunVisitor>
+bool RleReader::readRuns(RunVisitor&& visitor)
+{
+  int x = 0;
+  int y = 0;
+  int count = 0;
+  for (; position_ != end_; ++position_)
+  {
+    auto const c = *position_;
+    if (c >= '0' && c <= '9')
+    {
+      count = count * 10 + (c - '0');
+      continue;
+    }
+    // Whitespace and the prefixes of multi-state cells keep the pending count.
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || (c >= 'p' && c <= 'y'))
+    {
+      continue;
+    }
+    auto const run = (count > 0) ? count : 1;
+    count = 0;
+    if (c == 'b' || c == '.')
+    {
+      x += run;
+    }
+    else if (c == '$')
+    {
+      x = 0;
+      y += run;
+    }
+    else if (c == '!')
+    {
+      ++position_;
+      return true;
+    }
+    else if (c == 'o' || (c >= 'A' && c <= 'X'))
+    {
+      visitor(x, y, run);
+      x += run;
+    }
+  }
+  return false;
+}
+
+} // Utilities
+
+#endif // RLEREADER_H